@@ -0,0 +1,81 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+*/
+
+/**
+ * @file footprint_stamp_library.h
+ * @brief precomputed footprint cells for each heading, replaces online footprint rasterization
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#ifndef FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_FOOTPRINT_STAMP_LIBRARY_H_
+#define FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_FOOTPRINT_STAMP_LIBRARY_H_
+
+#include <costmap_2d/costmap_2d.h>
+#include <geometry_msgs/Point.h>
+#include <gslib/gaussian_debug.h>
+#include <stdint.h>
+
+#include <vector>
+#include <string>
+
+namespace fixpattern_local_planner {
+
+/**
+ * @class FootprintStampLibrary
+ * @brief Cells covered by the footprint outline relative to the robot center cell,
+ *        one stamp per heading bin. A stamp holds every cell within 1.75 cells of the
+ *        outline at the bin center heading, which bounds the cells the exact
+ *        rasterization of CostmapModel hits for any position in the robot cell and any
+ *        heading in the bin, so a lookup never misses one of them. The band is about
+ *        three cells wide, a stamp reads more cells than the rasterization and is more
+ *        conservative near obstacles.
+ */
+class FootprintStampLibrary {
+ public:
+  struct CellOffset {
+    int16_t dx;
+    int16_t dy;
+  };
+
+  FootprintStampLibrary();
+  ~FootprintStampLibrary();
+
+  /**
+   * @brief  Load stamps from file if it matches footprint and resolution, otherwise build and save them
+   * @param footprint_spec The footprint of the robot in robot frame
+   * @param resolution The resolution of the costmap stamps are used with
+   * @param file The file the library is persisted to, empty for not persisting
+   * @return True if the library is ready to use
+   */
+  bool Initialize(const std::vector<geometry_msgs::Point>& footprint_spec,
+                  double resolution, const std::string& file);
+
+  /**
+   * @brief  Footprint cost of a pose, same convention as CostmapModel::footprintCost
+   * @return -1 if the footprint hits a lethal or unknown cell or leaves the map, max cell cost otherwise
+   */
+  double FootprintCost(const costmap_2d::Costmap2D& costmap, double x, double y, double theta) const;
+
+  /** @brief  Cell offsets of the stamp for a heading, IsInitialized must be true */
+  const std::vector<CellOffset>& Stamp(double theta) const { return stamps_[Bin(theta)]; }
+
+  bool IsInitialized() const { return !stamps_.empty(); }
+
+ private:
+  int Bin(double theta) const;
+  void Build();
+  bool Load(const std::string& file);
+  bool Save(const std::string& file) const;
+  uint64_t Signature() const;
+
+  std::vector<geometry_msgs::Point> footprint_spec_;  ///< @brief The footprint stamps are built from
+  double resolution_;                                 ///< @brief Resolution of the costmap stamps are used with
+  double theta_step_;                                 ///< @brief Width of a heading bin
+  std::vector<std::vector<CellOffset> > stamps_;      ///< @brief Cell offsets of each heading bin
+};
+
+};  // namespace fixpattern_local_planner
+
+#endif  // FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_FOOTPRINT_STAMP_LIBRARY_H_
@@ -44,6 +44,10 @@
 #include <boost/thread.hpp>
 #include <gslib/gaussian_debug.h>
 
+#include <algorithm>
+#include <atomic>
+#include <string>
+
 namespace fixpattern_local_planner {
 
 class OdometryHelperRos {
@@ -62,10 +66,31 @@ public:
    */
   void odomCallback(const nav_msgs::Odometry::ConstPtr& msg);
 
+  /**
+   * @brief  Copy the velocity part and child frame of the latest odometry,
+   *         header, pose and covariances of base_odom are left untouched.
+   *         Callers only hand it to stopped(), which reads the twist alone
+   */
   void getOdom(nav_msgs::Odometry& base_odom);
 
   void getRobotVel(tf::Stamped<tf::Pose>& robot_vel);
 
+  /**
+   * @brief  Lock-free read of the latest odometry velocity
+   */
+  void getRobotVel(double* vx, double* vy, double* vth);
+
+  /**
+   * @brief  Lock-free read of the low-pass filtered odometry velocity
+   */
+  void getFilteredRobotVel(double* vx, double* vy, double* vth);
+
+  /**
+   * @brief  Set the weight of new odometry in the velocity filter
+   * @param alpha In (0, 1], 1 for no filtering
+   */
+  void setVelocityFilter(double alpha) { filter_alpha_ = std::max(0.01, std::min(1.0, alpha)); }
+
   /** @brief Set the odometry topic.  This overrides what was set in the constructor, if anything.
    *
    * This unsubscribes from the old topic (if any) and subscribes to the new one (if any).
@@ -82,12 +107,29 @@ private:
 
   // we listen on odometry on the odom topic
   ros::Subscriber odom_sub_;
-  nav_msgs::Odometry base_odom_;
-  boost::mutex odom_mutex_;
+
+  // fields needed by the planner, written by odomCallback only and read
+  // through a seqlock, odd odom_seq_ means a write is in progress
+  static const size_t kFrameIdCapacity = 64;
+  struct OdomSnapshot {
+    double vx, vy, vth;
+    double filtered_vx, filtered_vy, filtered_vth;
+    char child_frame_id[kFrameIdCapacity];
+    size_t child_frame_id_size;
+  };
+  OdomSnapshot readSnapshot() const;
+
+  std::atomic<unsigned int> odom_seq_;
+  std::atomic<double> vx_, vy_, vth_;
+  std::atomic<double> filtered_vx_, filtered_vy_, filtered_vth_;
+  std::atomic<char> child_frame_id_[kFrameIdCapacity];
+  std::atomic<size_t> child_frame_id_size_;
+  std::string last_child_frame_id_;  ///< only touched by odomCallback
+  bool odom_received_;  ///< only touched by odomCallback
+  double filter_alpha_;
   // global tf frame id
   std::string frame_id_; ///< The frame_id associated this data
 };
 
 } /* namespace fixpattern_local_planner */
-#define CHUNKY 1
 #endif  // FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_ODOMETRY_HELPER_ROS_H_
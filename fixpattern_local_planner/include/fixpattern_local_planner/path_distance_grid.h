@@ -0,0 +1,83 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+*/
+
+/**
+ * @file path_distance_grid.h
+ * @brief grid of nearest plan pose, gives path and goal distance with array reads
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#ifndef FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_PATH_DISTANCE_GRID_H_
+#define FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_PATH_DISTANCE_GRID_H_
+
+#include <geometry_msgs/PoseStamped.h>
+
+#include <vector>
+
+namespace fixpattern_local_planner {
+
+/**
+ * @class PathDistanceGrid
+ * @brief Wavefront from a whole path over a band around it, each cell keeps the index
+ *        of the path pose nearest to its centre, and each pose the path length left
+ *        after it. The grid is built once per path, every cycle only narrows the range
+ *        of poses that is the current local plan. A query reads the pose of its cell
+ *        and checks the two poses next to it along the path, so path distance is off
+ *        a scan of the local plan by less than one cell diagonal, and exact on smooth
+ *        paths sampled finer than the grid. A cell whose pose is out of the plan is
+ *        served from the plan end on that side if that is provably within one cell
+ *        of the plan, e.g. where the path loops back, the query fails otherwise.
+ */
+class PathDistanceGrid {
+ public:
+  PathDistanceGrid();
+  ~PathDistanceGrid();
+
+  /**
+   * @brief  Build the grid for a new path, the whole path is the current plan until SetPlanRange
+   * @param path The path, in the frame queries are made in
+   * @param resolution Cell size of the grid
+   * @param padding Distance the grid extends around the path
+   */
+  void Build(const std::vector<geometry_msgs::PoseStamped>& path, double resolution, double padding);
+
+  /** @brief  Drop the grid, queries fail until next Build */
+  void Clear();
+
+  /**
+   * @brief  Narrow queries to the poses of plan, which is a part of the path the grid is built for
+   * @return False if plan doesn't start on the path, queries fail until the next successful call
+   */
+  bool SetPlanRange(const std::vector<geometry_msgs::PoseStamped>& plan);
+
+  /**
+   * @brief  Distance from a point to the current plan
+   * @return False if the point is out of the grid or nearest to a pose out of the plan
+   */
+  bool PathDistance(double x, double y, double* dist) const;
+
+  /**
+   * @brief  Distance from a point to the nearest pose of the current plan, plus the path length
+   *         from that pose to the end of path
+   * @return False if the point is out of the grid or nearest to a pose out of the plan
+   */
+  bool GoalDistance(double x, double y, double* dist) const;
+
+ private:
+  int NearestIndex(double x, double y, double* dist) const;
+
+  double origin_x_, origin_y_;     ///< @brief World position of cell (0, 0) corner
+  double resolution_;              ///< @brief Cell size
+  int size_x_, size_y_;            ///< @brief Grid size in cells
+  std::vector<int> nearest_;       ///< @brief Nearest path index of each cell, -1 if out of the band
+  std::vector<float> dist_;        ///< @brief Distance from each cell centre to its nearest pose
+  std::vector<double> px_, py_;    ///< @brief Path positions the grid is built for
+  std::vector<double> remaining_;  ///< @brief Path length from each pose to the end of path
+  int begin_, end_;                ///< @brief Range of the path that is the current plan
+};
+
+};  // namespace fixpattern_local_planner
+
+#endif  // FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_PATH_DISTANCE_GRID_H_
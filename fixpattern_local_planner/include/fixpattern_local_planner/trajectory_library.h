@@ -0,0 +1,101 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+*/
+
+/**
+ * @file trajectory_library.h
+ * @brief rollouts relative to the start pose indexed by velocity and command bins, replaces online integration
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#ifndef FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_TRAJECTORY_LIBRARY_H_
+#define FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_TRAJECTORY_LIBRARY_H_
+
+#include <gslib/gaussian_debug.h>
+#include <stdint.h>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+namespace fixpattern_local_planner {
+
+/**
+ * @class TrajectoryLibrary
+ * @brief Poses of rollouts relative to their start pose, one entry per (current velocity bin,
+ *        command bin, sim time bin, steps). A rollout is a rotation and a translation of its
+ *        entry, the planner then checks each pose with a footprint lookup. Sampled commands
+ *        are snapped to bin centers so the command sent is the one rolled out, the current
+ *        velocity is taken at its bin center, which only shifts the acceleration phase.
+ *        Entries are added on first use up to a limit and persisted, a library saved by an
+ *        earlier run serves every command it has seen without integrating.
+ */
+class TrajectoryLibrary {
+ public:
+  struct RelativePose {
+    float x;
+    float y;
+    float theta;
+  };
+
+  TrajectoryLibrary();
+  ~TrajectoryLibrary();
+
+  /**
+   * @brief  Set up bins and load entries from file if it matches them, the file is saved to by Save
+   * @param vel_step Bin width of x velocities
+   * @param vtheta_step Bin width of theta velocities
+   * @param time_step Bin width of sim time, sim time is rounded up to it
+   * @param acc_x The x acceleration limit rollouts are integrated with
+   * @param acc_theta The theta acceleration limit rollouts are integrated with
+   * @param max_entries Entries kept at most, rollouts past it are integrated online
+   * @param file The file the library is persisted to, empty for not persisting
+   * @return True if the library is ready to use
+   */
+  bool Initialize(double vel_step, double vtheta_step, double time_step, double acc_x, double acc_theta,
+                  unsigned int max_entries, const std::string& file);
+
+  /**
+   * @brief  Snap velocities, command and sim time to their bins
+   * @return Key of the entry, kInvalidKey if a value is out of the bins
+   */
+  uint64_t Snap(double* vx, double* vtheta, double* vx_samp, double* vtheta_samp,
+                double* sim_time, int num_steps) const;
+
+  /** @brief  Entry of a key, NULL if it isn't in the library */
+  const std::vector<RelativePose>* Find(uint64_t key);
+
+  /** @brief  Add an entry, NULL if the library is full */
+  const std::vector<RelativePose>* Insert(uint64_t key, const std::vector<RelativePose>& poses);
+
+  /** @brief  Save entries to the file given to Initialize, if any */
+  bool Save() const;
+
+  /** @brief  True if rollouts with these acceleration limits may use the library */
+  bool Matches(double acc_x, double acc_theta) const { return acc_x == acc_x_ && acc_theta == acc_theta_; }
+
+  bool IsInitialized() const { return vel_step_ > 0.0; }
+  size_t size() const { return entries_.size(); }
+  unsigned int hits() const { return hits_; }
+  unsigned int misses() const { return misses_; }
+
+  static const uint64_t kInvalidKey = ~0ULL;
+
+ private:
+  bool Load();
+  uint64_t Signature() const;
+
+  double vel_step_;             ///< @brief Bin width of x velocities
+  double vtheta_step_;          ///< @brief Bin width of theta velocities
+  double time_step_;            ///< @brief Bin width of sim time
+  double acc_x_, acc_theta_;    ///< @brief Acceleration limits entries are integrated with
+  unsigned int max_entries_;    ///< @brief Entries kept at most
+  std::string file_;            ///< @brief The file the library is persisted to
+  std::unordered_map<uint64_t, std::vector<RelativePose> > entries_;
+  unsigned int hits_, misses_;  ///< @brief Lookups served by an entry and not, since Initialize
+};
+
+};  // namespace fixpattern_local_planner
+
+#endif  // FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_TRAJECTORY_LIBRARY_H_
@@ -14,6 +14,10 @@
 
 #include <vector>
 #include <cmath>
+#include <cfloat>
+#include <memory>
+#include <functional>
+#include <unordered_map>
 
 //for obstacle data access
 #include <costmap_2d/costmap_2d.h>
@@ -21,6 +25,9 @@
 
 #include <fixpattern_local_planner/world_model.h>
 #include <fixpattern_local_planner/trajectory.h>
+#include <fixpattern_local_planner/footprint_stamp_library.h>
+#include <fixpattern_local_planner/trajectory_library.h>
+#include <fixpattern_local_planner/path_distance_grid.h>
 
 //we'll take in a path as a vector of poses
 #include <geometry_msgs/PoseStamped.h>
@@ -35,9 +42,38 @@
 #include <fstream>
 
 namespace fixpattern_local_planner {
+
+/**
+ * @brief Work done by TrajectoryPlanner in one findBestPath call
+ */
+struct PlannerCycleStats {
+  int samples_considered;  ///< velocity samples considered
+  int samples_pruned;      ///< samples pruned before rollout
+  int rollouts;            ///< trajectories rolled out
+  int bounded;             ///< rollouts stopped early by the cost bound
+  int footprint_checks;    ///< footprint rasterizations or stamp lookups
+  int sweep_hits;          ///< footprint checks served by the forward sweep cache
+};
+
+/**
+ * @brief Parameters read by rollouts, set on construction and passed down by reference
+ */
+struct TrajectoryPlannerConfig {
+  double sim_time;                    ///< seconds each trajectory is "rolled-out"
+  double sim_granularity;             ///< distance between simulation points
+  double front_safe_sim_time;         ///< seconds front safe trajectory simulates
+  double front_safe_sim_granularity;  ///< distance between front safe simulation points
+  double pdist_scale;                 ///< weight of path distance
+  double occdist_scale;               ///< weight of obstacle cost
+  double max_vel_x;                   ///< max x velocity to explore
+  double max_vel_th;                  ///< max rotational velocity to explore
+};
+
 /**
  * @class TrajectoryPlanner
  * @brief Computes control velocities for a robot given a costmap, a plan, and the robot's position in the world.
+ *        A cycle keeps its sweep cache, work counters, clearance and best command in the planner,
+ *        so an instance runs one cycle at a time, on the thread that owns it.
  */
 class TrajectoryPlanner{
   friend class TrajectoryPlannerTest; //Need this for gtest to work
@@ -67,6 +103,7 @@ class TrajectoryPlanner{
    * @param min_vel_theta The minimum rotational velocity the controller will explore
    * @param min_in_place_vel_th The absolute value of the minimum in-place rotational velocity the controller will explore
    * @param backup_vel The velocity to use while backing up
+   * @param coarse_vtheta_step The stride of coarse vtheta samples, 1 samples uniformly
   */
   TrajectoryPlanner(WorldModel& world_model,
                     const costmap_2d::Costmap2D& costmap,
@@ -80,15 +117,14 @@ class TrajectoryPlanner{
                     double max_vel_x = 0.5, double min_vel_x = 0.1,
                     double max_vel_th = 1.0, double min_vel_th = -1.0, double min_in_place_vel_th = 0.4,
                     double backup_vel = -0.1, double min_hightlight_dis = 0.5, 
-                    double final_vel_ratio = 1.0, double final_goal_dis_th = 1.5);
+                    double final_vel_ratio = 1.0, double final_goal_dis_th = 1.5,
+                    int coarse_vtheta_step = 1);
 
   /**
    * @brief  Destructs a trajectory controller
    */
   ~TrajectoryPlanner();
 
-  void SetParameters(double max_vel_x, double max_vel_theta, double sim_time);
-
   /**
    * @brief  Given the current position, orientation, and velocity of the robot, return a trajectory to follow
    * @param global_pose The current pose of the robot in world space
@@ -110,6 +146,22 @@ class TrajectoryPlanner{
    */
   void UpdateGoalAndPlan(const geometry_msgs::PoseStamped& goal, const std::vector<geometry_msgs::PoseStamped>& new_plan);
 
+  /**
+   * @brief  Build the path and goal distance grid from the whole path, plans given to
+   *         UpdateGoalAndPlan that are a part of it are then served from the grid
+   * @param path The whole path in the costmap frame, empty to drop the grid
+   */
+  void UpdatePathGrid(const std::vector<geometry_msgs::PoseStamped>& path);
+
+  /**
+   * @brief  Distance from a point to the nearest pose of plan, plus the path length from
+   *         that pose to the end of the path given to UpdatePathGrid
+   * @return False if the point is out of the grid
+   */
+  bool goalDistance(double x, double y, double* dist) const {
+    return path_grid_.GoalDistance(x, y, dist);
+  }
+
   /**
    * @brief  Generate and score a single trajectory
    * @param x The x position of the robot
@@ -160,8 +212,81 @@ class TrajectoryPlanner{
                                   double vtheta, double vx_samp, double vy_samp,
                                   double vtheta_samp, double sim_time);
 
+  /**
+   * @brief  Check footprint on the arc rotating in place from theta by angle, headings
+   *         are taken close enough that the footprint outline moves at most half a cell
+   * @param x The x position of the robot
+   * @param y The y position of the robot
+   * @param theta The orientation of the robot
+   * @param angle The signed angle to rotate
+   * @return True if no heading on the arc hits an obstacle
+   */
+  bool checkRotationSweep(double x, double y, double theta, double angle);
+
+  /**
+   * @brief  Check in-place rotation with vtheta towards the goal heading, the arc is the
+   *         larger of angle_to_goal and the braking arc of vtheta under acc_lim_theta_
+   * @param vtheta The rotational velocity to command
+   * @param angle_to_goal The signed angle from theta to the goal heading
+   * @return True if the rotation is legal
+   */
+  bool checkInPlaceRotation(double x, double y, double theta, double vtheta, double angle_to_goal);
+
+  /**
+   * @brief  Check the straight segment the robot covers when braking from vx, vy with acc_lim_x_
+   * @return True if the stopping segment is legal
+   */
+  bool checkStopping(double x, double y, double theta, double vx, double vy);
+
+  /**
+   * @brief  Start clearance queries from a robot pose, findBestPath does it at the start
+   *         of every cycle since the costmap changes between cycles
+   */
+  void updateClearance(double x, double y, double theta);
+
+  /**
+   * @brief  Free distance straight ahead of the clearance pose, swept lazily and kept
+   *         until the next updateClearance
+   * @param max_dis The distance of interest, clearance beyond it is not checked
+   * @return The clearance, at most max_dis
+   */
+  double frontClearance(double max_dis) { return sweepClearance(1.0, max_dis, &front_clearance_); }
+
+  /** @brief Same as frontClearance, straight behind the clearance pose */
+  double rearClearance(double max_dis) { return sweepClearance(-1.0, max_dis, &rear_clearance_); }
+
   /** @brief Set the footprint specification of the robot. */
-  void setFootprint( std::vector<geometry_msgs::Point> footprint ) { footprint_spec_ = footprint; }
+  void setFootprint( std::vector<geometry_msgs::Point> footprint ) {
+    footprint_spec_ = footprint;
+    if (footprint_stamps_.IsInitialized()) footprint_stamps_.Initialize(footprint_spec_, costmap_.getResolution(), "");
+  }
+
+  /**
+   * @brief  Use precomputed footprint stamps instead of rasterizing footprint for each check
+   * @param file The file stamps are loaded from or saved to, empty for not persisting
+   * @return True if stamps are ready to use
+   */
+  bool initFootprintStamps(const std::string& file) {
+    return footprint_stamps_.Initialize(footprint_spec_, costmap_.getResolution(), file);
+  }
+
+  /**
+   * @brief  Roll sampled trajectories out of a library of relative poses instead of
+   *         integrating them, sampled commands are snapped to the library bins
+   * @param vel_step Bin width of x velocities
+   * @param vtheta_step Bin width of theta velocities
+   * @param time_step Bin width of sim time
+   * @param max_entries Entries kept at most
+   * @param file The file the library is loaded from and saved to on destruction, empty for not persisting
+   * @return True if the library is ready to use
+   */
+  bool initTrajectoryLibrary(double vel_step, double vtheta_step, double time_step,
+                             unsigned int max_entries, const std::string& file) {
+    return trajectory_library_.Initialize(vel_step, vtheta_step, time_step, acc_lim_x_, acc_lim_theta_,
+                                          max_entries, file);
+  }
+
+  const TrajectoryLibrary& getTrajectoryLibrary() const { return trajectory_library_; }
 
   /** @brief Return the footprint specification of the robot. */
   geometry_msgs::Polygon getFootprintPolygon() const { return costmap_2d::toPolygon(footprint_spec_); }
@@ -171,6 +296,18 @@ class TrajectoryPlanner{
     return need_backward_;
   }
 
+  /** @brief Return the work done in last findBestPath */
+  PlannerCycleStats getCycleStats() const {
+    PlannerCycleStats stats;
+    stats.samples_considered = samples_considered_;
+    stats.samples_pruned = samples_pruned_;
+    stats.rollouts = samples_rolled_out_;
+    stats.bounded = samples_bounded_;
+    stats.footprint_checks = footprint_checks_;
+    stats.sweep_hits = sweep_hits_;
+    return stats;
+  }
+
   // for convenience of trajectory_planner_ros
 //  void set_num_calc_footprint_cost(int num_calc_footprint_cost) { num_calc_footprint_cost_ = num_calc_footprint_cost; }
 //  void set_max_vel_theta(double max_vel_theta) { max_vel_theta_ = max_vel_theta; }
@@ -179,6 +316,7 @@ class TrajectoryPlanner{
  private:
   /**
    * @brief  Create the trajectories we wish to explore, score them, and return the best option
+   * @param config The configuration of this cycle, passed down to every rollout
    * @param x The x position of the robot
    * @param y The y position of the robot
    * @param theta The orientation of the robot
@@ -194,12 +332,14 @@ class TrajectoryPlanner{
    * @param all_explored all trajectories that sampled
    * @return
    */
-  Trajectory createTrajectories(double x, double y, double theta, double traj_vel, double highlight, double current_point_dis,
+  Trajectory createTrajectories(const TrajectoryPlannerConfig& config,
+                                double x, double y, double theta, double traj_vel, double highlight, double current_point_dis,
                                 double vx, double vy, double vtheta,
                                 double acc_x, double acc_y, double acc_theta, std::vector<Trajectory>* all_explored);
 
   /**
    * @brief  Generate and score a single trajectory
+   * @param config The configuration of this run
    * @param x The x position of the robot
    * @param y The y position of the robot
    * @param theta The orientation of the robot
@@ -215,27 +355,69 @@ class TrajectoryPlanner{
    * @param impossible_cost The cost value of a cell in the local map grid that is considered impassable
    * @param traj Will be set to the generated trajectory with its associated score
    * @param sim_time Simulation time
+   * @param cost_bound Stop rolling out with cost = -3 once cost exceeds this bound
+   * @param lattice Poses relative to the start pose from libraryRollout, NULL for integrating online
    */
-  void generateTrajectory(double x, double y, double theta, double vx, double vy,
+  void generateTrajectory(const TrajectoryPlannerConfig& config,
+                          double x, double y, double theta, double vx, double vy,
                           double vtheta, double vx_samp, double vy_samp, double vtheta_samp, double acc_x, double acc_y,
-                          double acc_theta, double impossible_cost, Trajectory& traj, double sim_time);
+                          double acc_theta, double impossible_cost, Trajectory& traj, double sim_time,
+                          double cost_bound = DBL_MAX,
+                          const std::vector<TrajectoryLibrary::RelativePose>* lattice = NULL);
+
+  /**
+   * @brief  Snap a sampled command and sim time to the trajectory library bins and get its
+   *         relative poses, integrated at bin centers and added to the library on first use
+   * @return The relative poses, NULL if the library is off or can't serve the command
+   */
+  const std::vector<TrajectoryLibrary::RelativePose>* libraryRollout(const TrajectoryPlannerConfig& config,
+                                                                     double vx, double vtheta,
+                                                                     double* vx_samp, double* vtheta_samp,
+                                                                     double acc_x, double acc_theta,
+                                                                     double* sim_time);
 
   void generateTrajectoryWithoutCheckingFootprint(
+    const TrajectoryPlannerConfig& config,
     double x, double y, double theta, double vx, double vy, double vtheta,
     double vx_samp, double vy_samp, double vtheta_samp, double acc_x, double acc_y, double acc_theta,
     double impossible_cost, Trajectory& traj, double sim_time);
 
-  void CalculatePathCost(double x, double y, double theta, double vx, double vy,
+  void CalculatePathCost(const TrajectoryPlannerConfig& config,
+                         double x, double y, double theta, double vx, double vy,
                          double vtheta, double vx_samp, double vy_samp, double vtheta_samp, double acc_x, double acc_y,
                          double acc_theta, double impossible_cost, Trajectory& traj, double sim_time);
 
   /**
    * @brief  Generate and score a single trajectory for recovery
    */
-  void generateTrajectoryForRecovery(double x, double y, double theta, double vx, double vy,
+  void generateTrajectoryForRecovery(const TrajectoryPlannerConfig& config,
+                                     double x, double y, double theta, double vx, double vy,
                                      double vtheta, double vx_samp, double vy_samp, double vtheta_samp, double acc_x, double acc_y,
                                      double acc_theta, double impossible_cost, Trajectory& traj, double sim_time, int within_obs_thresh);
 
+  /**
+   * @brief  Check admissibility of a vtheta sample and roll it out if admissible
+   * @param cost_bound Best cost so far, rollout stops early once exceeding it, lowered by valid samples
+   * @param traj Will be set to the generated trajectory, cost_ = -1 if pruned, -3 if bounded
+   * @param all_explored all trajectories that sampled
+   */
+  void sampleVtheta(const TrajectoryPlannerConfig& config,
+                    double x, double y, double theta, double vx, double vy, double vtheta,
+                    double vx_samp, double vtheta_samp, double acc_x, double acc_y, double acc_theta,
+                    double impossible_cost, double sim_time, double* cost_bound,
+                    Trajectory* traj, std::vector<Trajectory>* all_explored);
+
+  /**
+   * @brief  Dynamic window admissibility check of a velocity sample before rollout,
+   *         rejects circle trajectories and samples whose footprint collides at the
+   *         rollout pose reached after braking distance
+   * @return False if the sample is provably infeasible, true otherwise
+   */
+  bool isSampleAdmissible(const TrajectoryPlannerConfig& config,
+                          double x, double y, double theta, double vx, double vy,
+                          double vtheta, double vx_samp, double vy_samp, double vtheta_samp,
+                          double acc_x, double acc_y, double acc_theta, double sim_time);
+
   /**
    * @brief  Checks the legality of the robot footprint at a position and orientation using the world model
    * @param x_i The x position of the robot
@@ -245,8 +427,27 @@ class TrajectoryPlanner{
    */
   double footprintCost(double x_i, double y_i, double theta_i);
 
+  /**
+   * @brief  Distance from a point to global_plan_, read from path_grid_ if the point is in it
+   * @param x The x position
+   * @param y The y position
+   * @return The distance to the nearest pose of plan
+   */
+  double pathDistance(double x, double y);
+
+  /**
+   * @brief  Same as footprintCost, but a pose already checked in this cycle is served
+   *         from the per-cycle cache, keyed on the exact pose
+   * @param x_i The x position of the robot
+   * @param y_i The y position of the robot
+   * @param theta_i The orientation of the robot
+   * @return
+   */
+  double sweepFootprintCost(double x_i, double y_i, double theta_i);
+
   /**
    * @brief  Check if front is safe
+   * @param config The configuration of this cycle
    * @param x The x position of the robot
    * @param y The y position of the robot
    * @param theta The orientation of the robot
@@ -254,13 +455,21 @@ class TrajectoryPlanner{
    * @param vy The y velocity of the robot
    * @param vtheta The theta velocity of the robot
    */
-  bool checkFrontSafe(double x, double y, double theta,
+  bool checkFrontSafe(const TrajectoryPlannerConfig& config,
+                      double x, double y, double theta,
                       double vx, double vy, double vtheta);
 
   void SetNeedBackward(double x, double y, double theta, double vx, double vy,
                        double vtheta, double vx_samp, double vy_samp, double vtheta_samp, double acc_x, double acc_y,
                        double acc_theta, double impossible_cost, double sim_time);
 
+  struct Clearance {
+    double dis;    ///< @brief Free distance swept so far
+    bool blocked;  ///< @brief True once the sweep hit an obstacle at dis
+  };
+
+  double sweepClearance(double direction, double max_dis, Clearance* clearance);
+
 //  fixpattern_local_planner::FootprintHelper footprint_helper_;
 
   const costmap_2d::Costmap2D& costmap_; ///< @brief Provides access to cost map information
@@ -269,6 +478,7 @@ class TrajectoryPlanner{
   std::vector<geometry_msgs::Point> footprint_spec_; ///< @brief The footprint specification of the robot
 
   std::vector<geometry_msgs::PoseStamped> global_plan_; ///< @brief The global path for the robot to follow
+  PathDistanceGrid path_grid_; ///< @brief Nearest pose of the whole path around it, global_plan_ is a range of it
 
   int num_calc_footprint_cost_; ///< @brief The number of points that should check footprintCost
 
@@ -279,16 +489,12 @@ class TrajectoryPlanner{
   double final_goal_x_, final_goal_y_; ///< @brief The end position of the plan.
   bool final_goal_position_valid_; ///< @brief True if final_goal_x_ and final_goal_y_ have valid data.  Only false if an empty path is sent.
 
-  double sim_time_; ///< @brief The number of seconds each trajectory is "rolled-out"
-  double sim_granularity_; ///< @brief The distance between simulation points
-
-  double front_safe_sim_time_; ///< @brief The number of seconds front safe trajectory simulates
-  double front_safe_sim_granularity_; ///< @brief The distance between front safe simulation points
+  TrajectoryPlannerConfig config_; ///< @brief Parameters of rollouts
 
   int vx_samples_; ///< @brief The number of samples we'll take in the x dimenstion of the control space
   int vtheta_samples_; ///< @brief The number of samples we'll take in the theta dimension of the control space
 
-  double pdist_scale_, gdist_scale_, occdist_scale_; ///< @brief Scaling factors for the controller's cost function
+  double gdist_scale_; ///< @brief Scaling factor for how aggresively the robot should pursue a local goal
   double acc_lim_x_, acc_lim_y_, acc_lim_theta_; ///< @brief The acceleration limits of the robot
 
   double prev_x_, prev_y_; ///< @brief Used to calculate the distance the robot has traveled before reseting oscillation booleans
@@ -304,7 +510,7 @@ class TrajectoryPlanner{
   double escape_reset_dist_, escape_reset_theta_; ///< @brief The distance the robot must travel before it can leave escape mode
   bool holonomic_robot_; ///< @brief Is the robot holonomic or not?
 
-  double max_vel_x_, min_vel_x_, max_vel_th_, min_vel_th_, min_in_place_vel_th_; ///< @brief Velocity limits for the controller
+  double min_vel_x_, min_vel_th_, min_in_place_vel_th_; ///< @brief Velocity limits for the controller
   double min_hightlight_dis_;
   double backup_vel_; ///< @brief The velocity to use while backing up
 
@@ -322,7 +528,41 @@ class TrajectoryPlanner{
 
   bool need_backward_;
 
-  boost::mutex configuration_mutex_;
+  double clearance_x_, clearance_y_, clearance_theta_; ///< @brief Pose the clearances are measured from
+  Clearance front_clearance_, rear_clearance_; ///< @brief Straight clearances of this cycle
+
+  FootprintStampLibrary footprint_stamps_; ///< @brief Precomputed footprint cells, used by footprintCost if initialized
+  TrajectoryLibrary trajectory_library_; ///< @brief Relative poses of sampled rollouts, used by libraryRollout if initialized
+
+  struct SweepPose {
+    double x, y, theta;
+    bool operator==(const SweepPose& other) const {
+      return x == other.x && y == other.y && theta == other.theta;
+    }
+  };
+  struct SweepPoseHash {
+    size_t operator()(const SweepPose& pose) const {
+      std::hash<double> hash;
+      size_t seed = hash(pose.x);
+      seed ^= hash(pose.y) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      seed ^= hash(pose.theta) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      return seed;
+    }
+  };
+  std::unordered_map<SweepPose, double, SweepPoseHash> front_sweep_cache_; ///< @brief Footprint costs of exact poses in this cycle
+  bool front_sweep_active_; ///< @brief True while findBestPath is running, i.e. front_sweep_cache_ is valid
+
+  int coarse_vtheta_step_; ///< @brief The stride of coarse vtheta samples before refining
+
+  int samples_considered_; ///< @brief The number of velocity samples considered in last cycle
+  int samples_pruned_; ///< @brief The number of velocity samples pruned before rollout in last cycle
+  int samples_rolled_out_; ///< @brief The number of trajectories rolled out in last cycle
+  int samples_bounded_; ///< @brief The number of rollouts stopped early by the cost bound in last cycle
+  int footprint_checks_; ///< @brief The number of footprintCost calls in last cycle
+  int sweep_hits_; ///< @brief The number of footprint checks served by front_sweep_cache_ in last cycle
+
+  double last_best_vtheta_; ///< @brief vtheta of best trajectory in last cycle, used to warm start sampling
+  bool last_best_valid_; ///< @brief True if last cycle found a valid sampled trajectory
 
   /**
    * @brief  Compute x position based on velocity
@@ -20,6 +20,7 @@
 #include <fixpattern_local_planner/costmap_model.h>
 #include <fixpattern_local_planner/trajectory_planner.h>
 #include <fixpattern_local_planner/look_ahead_planner.h>
+#include <fixpattern_local_planner/velocity_profile.h>
 //#include <fixpattern_local_planner/map_grid_visualizer.h>
 #include <fixpattern_local_planner/planar_laser_scan.h>
 #include <tf/transform_datatypes.h>
@@ -40,6 +41,8 @@
 
 #include <vector>
 #include <string>
+#include <fstream>
+#include <memory>
 
 namespace fixpattern_local_planner {
 
@@ -101,6 +104,31 @@ class FixPatternTrajectoryPlannerROS {
    */
   bool setPlan(const std::vector<fixpattern_path::PathPoint>& orig_global_plan, const std::string& orig_frame_id);
 
+  /**
+   * @brief  Set the plan from a shared path that is never modified after it is passed in.
+   *         Points equal to the last plan at its start or end are kept, only the rest is converted
+   * @param path The path, the plan starts at path->at(offset)
+   * @param offset Index of the first point of the plan in path
+   * @param frame_id The frame id of path
+   * @param profile Velocity profile of path from makeVelocityProfile, computed here if NULL and path is new
+   * @return True if the plan was updated successfully, false otherwise
+   */
+  bool setPlan(const std::shared_ptr<const std::vector<fixpattern_path::PathPoint> >& path,
+               size_t offset, const std::string& frame_id,
+               const std::shared_ptr<const VelocityProfile>& profile = std::shared_ptr<const VelocityProfile>());
+
+  /**
+   * @brief  Velocity profile of a path with the limits of this planner. Only reads limits set
+   *         on initialize, so the thread making a path can call it before passing the path to setPlan
+   */
+  std::shared_ptr<const VelocityProfile> makeVelocityProfile(const std::vector<fixpattern_path::PathPoint>& path) const;
+
+  /**
+   * @brief  Tell the planner the costmap content changed, the clearance part of the path
+   *         velocity is refreshed on a new revision or when the plan moves
+   */
+  void setCostmapRevision(unsigned int revision) { costmap_revision_ = revision; }
+
   /**
    * @brief  Check if the goal pose has been achieved
    * @return True if achieved, false otherwise
@@ -187,10 +215,30 @@ class FixPatternTrajectoryPlannerROS {
    */
   bool stopWithAccLimits(PlannerType planner_type, const tf::Stamped<tf::Pose>& global_pose, const tf::Stamped<tf::Pose>& robot_vel, geometry_msgs::Twist* cmd_vel);
 
+  /**
+   * @brief Log work and latency of the planner in this cycle, and append them to planner_stats_file_ if set
+   * @param planner_type Which planner was used
+   * @param latency Wall time of the planner call in seconds
+   */
+  void recordPlannerStats(PlannerType planner_type, double latency);
+
   double sign(double x) {
     return x < 0.0 ? -1.0 : 1.0;
   }
 
+  /** @brief Point i of the plan passed in by setPlan, without extension */
+  const fixpattern_path::PathPoint& pathPoint(size_t i) const {
+    return (*plan_source_)[plan_offset_ + i];
+  }
+
+  /** @brief Size of the plan passed in by setPlan, without extension */
+  size_t pathSize() const {
+    return plan_source_ ? plan_source_->size() - plan_offset_ : 0;
+  }
+
+  /** @brief Velocity to track at point i of the plan, from the profile and costmap clearance ahead */
+  double pathVelocity(size_t i);
+
   WorldModel* world_model_;  ///< @brief The world model that the controller will use
   TrajectoryPlanner* tc_;    ///< @brief The trajectory controller
   LookAheadPlanner* la_;     ///< @brief The look-ahead controller
@@ -204,8 +252,17 @@ class FixPatternTrajectoryPlannerROS {
   std::string robot_base_frame_;           ///< @brief Used as the base frame id of the robot
   double rot_stopped_velocity_, trans_stopped_velocity_;
   double min_in_place_vel_th_;
-  std::vector<geometry_msgs::PoseStamped> global_plan_;
-  std::vector<fixpattern_path::PathPoint> fixpattern_path_;
+  std::vector<geometry_msgs::PoseStamped> global_plan_;  ///< @brief Converted plan, pruned from front, the last plan_extension_ poses are the extension
+  std::shared_ptr<const std::vector<fixpattern_path::PathPoint> > plan_source_;  ///< @brief Path passed in by setPlan
+  size_t plan_offset_;      ///< @brief Index of the first plan point in plan_source_
+  size_t plan_extension_;   ///< @brief The number of poses appended to global_plan_ for a short plan
+  std::string plan_frame_id_;  ///< @brief Frame id of global_plan_
+  VelocityProfile profile_limits_;  ///< @brief Limits of velocity profiles, makeVelocityProfile copies it
+  std::shared_ptr<const VelocityProfile> velocity_profile_;  ///< @brief Velocity profile of plan_source_
+  unsigned int costmap_revision_;    ///< @brief Revision of costmap content set by setCostmapRevision
+  unsigned int clearance_revision_;  ///< @brief Costmap revision clearance_vel_ was computed at
+  size_t clearance_index_;           ///< @brief Path index clearance_vel_ was computed for
+  double clearance_vel_;             ///< @brief Last pathVelocity, -1 if it has to be computed
   bool prune_plan_;
   bool rotating_to_route_direction_;
   bool need_rotate_to_path_;
@@ -244,6 +301,9 @@ class FixPatternTrajectoryPlannerROS {
   int max_rotate_try_times_;
   int try_rotate_;
   geometry_msgs::PoseStamped global_goal_;
+
+  std::string planner_stats_file_;
+  std::ofstream planner_stats_stream_;
 };
 
 };  // namespace fixpattern_local_planner
@@ -0,0 +1,72 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+*/
+
+/**
+ * @file velocity_profile.h
+ * @brief path-wide velocity profile, limited by curvature, clearance and acceleration
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#ifndef FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_VELOCITY_PROFILE_H_
+#define FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_VELOCITY_PROFILE_H_
+
+#include <costmap_2d/costmap_2d.h>
+#include <fixpattern_path/path.h>
+
+#include <vector>
+
+namespace fixpattern_local_planner {
+
+/**
+ * @class VelocityProfile
+ * @brief Fastest velocity at each point of a path that the robot can follow. Each point is
+ *        limited by its max_vel and by max_vel_theta on its radius. Corner points and the
+ *        end of the path stop the robot. A backward and a forward pass then keep the
+ *        profile within acc_lim_x. The profile only depends on the path, it is computed
+ *        where the path is made and never modified after. Costmap clearance changes every
+ *        cycle, ClearanceVelocity applies it to the points a robot can still brake for.
+ */
+class VelocityProfile {
+ public:
+  VelocityProfile();
+  ~VelocityProfile();
+
+  void SetLimits(double max_vel_x, double min_vel_x, double max_vel_theta, double acc_lim_x);
+
+  /**
+   * @brief  Compute the profile of path from offset on
+   * @param path The path
+   * @param offset Index of the first point to compute
+   */
+  void Compute(const std::vector<fixpattern_path::PathPoint>& path, size_t offset);
+
+  void Clear() { vel_.clear(); offset_ = 0; }
+
+  /**
+   * @brief  Profile velocity at point index of the path passed to Compute
+   * @return False if the point is not covered by the profile
+   */
+  bool Velocity(size_t index, double* vel) const;
+
+  /**
+   * @brief  Profile velocity at point index, also braking for points ahead where the costmap
+   *         says obstacles are close. Only points within braking distance from max_vel_x
+   *         are looked at, points further can't lower it
+   * @param path The path passed to Compute
+   * @param costmap Costmap in the frame of path
+   * @return False if the point is not covered by the profile
+   */
+  bool ClearanceVelocity(const std::vector<fixpattern_path::PathPoint>& path, size_t index,
+                         const costmap_2d::Costmap2D& costmap, double* vel) const;
+
+ private:
+  double max_vel_x_, min_vel_x_, max_vel_theta_, acc_lim_x_;
+  size_t offset_;            ///< @brief Path index of vel_[0]
+  std::vector<double> vel_;  ///< @brief Profile velocity of each point from offset_ on
+};
+
+};  // namespace fixpattern_local_planner
+
+#endif  // FIXPATTERN_LOCAL_PLANNER_INCLUDE_FIXPATTERN_LOCAL_PLANNER_VELOCITY_PROFILE_H_
@@ -0,0 +1,234 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+ */
+
+/**
+ * @file footprint_stamp_library.cpp
+ * @brief precomputed footprint cells for each heading, replaces online footprint rasterization
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#include <fixpattern_local_planner/footprint_stamp_library.h>
+#include <costmap_2d/cost_values.h>
+#include <angles/angles.h>
+
+#include <cmath>
+#include <fstream>
+#include <set>
+#include <utility>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace fixpattern_local_planner {
+
+namespace {
+
+const uint32_t kStampFileMagic = 0x32535046;  // "FPS2", stamps built from the band below
+// chebyshev distance in cells from the outline at bin center heading that holds every
+// cell of the exact rasterization, 0.5 vertex cell + 0.5 robot offset in its cell +
+// 0.5 line cell + 0.25 heading within bin
+const double kStampBand = 1.75;
+// room for rounding in worldToMap and the heading bin lookup
+const double kStampBandTolerance = 1e-3;
+
+uint64_t HashBytes(uint64_t seed, const void* data, size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    seed ^= bytes[i];
+    seed *= 1099511628211ULL;
+  }
+  return seed;
+}
+
+// whether segment (x0, y0)-(x1, y1) comes within chebyshev distance band of (cx, cy),
+// i.e. it crosses the square of half size band around the point
+bool SegmentWithin(double x0, double y0, double x1, double y1, int cx, int cy, double band) {
+  double dx = x1 - x0, dy = y1 - y0;
+  double p[4] = { -dx, dx, -dy, dy };
+  double q[4] = { x0 - (cx - band), (cx + band) - x0, y0 - (cy - band), (cy + band) - y0 };
+  double t0 = 0.0, t1 = 1.0;
+  for (int i = 0; i < 4; ++i) {
+    if (p[i] == 0.0) {
+      if (q[i] < 0.0) return false;
+      continue;
+    }
+    double t = q[i] / p[i];
+    if (p[i] < 0.0) {
+      t0 = std::max(t0, t);
+    } else {
+      t1 = std::min(t1, t);
+    }
+    if (t0 > t1) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+FootprintStampLibrary::FootprintStampLibrary()
+  : resolution_(0.0), theta_step_(0.0) { }
+
+FootprintStampLibrary::~FootprintStampLibrary() { }
+
+bool FootprintStampLibrary::Initialize(const std::vector<geometry_msgs::Point>& footprint_spec,
+                                       double resolution, const std::string& file) {
+  stamps_.clear();
+  if (footprint_spec.size() < 3 || resolution <= 0.0) {
+    GAUSSIAN_WARN("[FOOTPRINT STAMP] invalid footprint or resolution, stamps disabled");
+    return false;
+  }
+  footprint_spec_ = footprint_spec;
+  resolution_ = resolution;
+
+  if (!file.empty() && Load(file)) {
+    GAUSSIAN_INFO("[FOOTPRINT STAMP] loaded %zu stamps from %s", stamps_.size(), file.c_str());
+    return true;
+  }
+
+  Build();
+  GAUSSIAN_INFO("[FOOTPRINT STAMP] built %zu stamps", stamps_.size());
+  if (!file.empty() && !Save(file)) {
+    GAUSSIAN_WARN("[FOOTPRINT STAMP] failed to save stamps to %s", file.c_str());
+  }
+  return true;
+}
+
+void FootprintStampLibrary::Build() {
+  double radius = 0.0;
+  for (unsigned int i = 0; i < footprint_spec_.size(); ++i) {
+    radius = std::max(radius, hypot(footprint_spec_[i].x, footprint_spec_[i].y));
+  }
+  // footprint vertices move at most half a cell within a heading bin
+  int num_bins = static_cast<int>(ceil(2.0 * M_PI / (0.5 * resolution_ / std::max(radius, resolution_))));
+  theta_step_ = 2.0 * M_PI / num_bins;
+
+  // in cells relative to the robot cell, a rasterized vertex is within 0.5 of the vertex
+  // shifted by the robot offset in its cell less 0.5, which is up to 0.5 itself, and a line
+  // cell is within 0.5 of the line between its vertex cells. Vertices are within 0.25 of
+  // where they are at the bin center heading, so each cell the exact rasterization of a
+  // pose in the bin hits is within kStampBand of the outline at bin center heading
+  double band = kStampBand + kStampBandTolerance;
+  int reach = static_cast<int>(ceil(band));
+  stamps_.resize(num_bins);
+  for (int b = 0; b < num_bins; ++b) {
+    double th = -M_PI + (b + 0.5) * theta_step_;
+    double cos_th = cos(th), sin_th = sin(th);
+    std::vector<std::pair<double, double> > vertices;
+    for (unsigned int i = 0; i < footprint_spec_.size(); ++i) {
+      vertices.push_back(std::make_pair((cos_th * footprint_spec_[i].x - sin_th * footprint_spec_[i].y) / resolution_,
+                                        (sin_th * footprint_spec_[i].x + cos_th * footprint_spec_[i].y) / resolution_));
+    }
+    std::set<std::pair<int, int> > cells;
+    for (unsigned int i = 0; i < vertices.size(); ++i) {
+      const std::pair<double, double>& v0 = vertices[i];
+      const std::pair<double, double>& v1 = vertices[(i + 1) % vertices.size()];
+      int min_x = static_cast<int>(floor(std::min(v0.first, v1.first))) - reach;
+      int max_x = static_cast<int>(ceil(std::max(v0.first, v1.first))) + reach;
+      int min_y = static_cast<int>(floor(std::min(v0.second, v1.second))) - reach;
+      int max_y = static_cast<int>(ceil(std::max(v0.second, v1.second))) + reach;
+      for (int cx = min_x; cx <= max_x; ++cx) {
+        for (int cy = min_y; cy <= max_y; ++cy) {
+          if (SegmentWithin(v0.first, v0.second, v1.first, v1.second, cx, cy, band)) {
+            cells.insert(std::make_pair(cx, cy));
+          }
+        }
+      }
+    }
+    stamps_[b].reserve(cells.size());
+    for (std::set<std::pair<int, int> >::const_iterator it = cells.begin(); it != cells.end(); ++it) {
+      CellOffset offset;
+      offset.dx = static_cast<int16_t>(it->first);
+      offset.dy = static_cast<int16_t>(it->second);
+      stamps_[b].push_back(offset);
+    }
+  }
+}
+
+int FootprintStampLibrary::Bin(double theta) const {
+  int bin = static_cast<int>(floor((angles::normalize_angle(theta) + M_PI) / theta_step_));
+  return std::max(0, std::min(static_cast<int>(stamps_.size()) - 1, bin));
+}
+
+double FootprintStampLibrary::FootprintCost(const costmap_2d::Costmap2D& costmap,
+                                            double x, double y, double theta) const {
+  unsigned int cell_x, cell_y;
+  if (!costmap.worldToMap(x, y, cell_x, cell_y)) return -1.0;
+
+  int size_x = costmap.getSizeInCellsX();
+  int size_y = costmap.getSizeInCellsY();
+  double footprint_cost = 0.0;
+  const std::vector<CellOffset>& stamp = stamps_[Bin(theta)];
+  for (unsigned int i = 0; i < stamp.size(); ++i) {
+    int mx = static_cast<int>(cell_x) + stamp[i].dx;
+    int my = static_cast<int>(cell_y) + stamp[i].dy;
+    if (mx < 0 || my < 0 || mx >= size_x || my >= size_y) return -1.0;
+
+    unsigned char cost = costmap.getCost(mx, my);
+    if (cost == costmap_2d::LETHAL_OBSTACLE || cost == costmap_2d::NO_INFORMATION) return -1.0;
+    footprint_cost = std::max(footprint_cost, static_cast<double>(cost));
+  }
+  return footprint_cost;
+}
+
+uint64_t FootprintStampLibrary::Signature() const {
+  uint64_t seed = 14695981039346656037ULL;
+  for (unsigned int i = 0; i < footprint_spec_.size(); ++i) {
+    seed = HashBytes(seed, &footprint_spec_[i].x, sizeof(double));
+    seed = HashBytes(seed, &footprint_spec_[i].y, sizeof(double));
+  }
+  return HashBytes(seed, &resolution_, sizeof(double));
+}
+
+bool FootprintStampLibrary::Load(const std::string& file) {
+  std::ifstream in(file.c_str(), std::ios::binary);
+  if (!in.is_open()) return false;
+
+  uint32_t magic = 0, num_bins = 0;
+  uint64_t signature = 0;
+  double theta_step = 0.0;
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char*>(&signature), sizeof(signature));
+  in.read(reinterpret_cast<char*>(&theta_step), sizeof(theta_step));
+  in.read(reinterpret_cast<char*>(&num_bins), sizeof(num_bins));
+  if (!in || magic != kStampFileMagic || signature != Signature() || num_bins == 0) {
+    GAUSSIAN_INFO("[FOOTPRINT STAMP] %s doesn't match footprint, rebuild", file.c_str());
+    return false;
+  }
+
+  std::vector<std::vector<CellOffset> > stamps(num_bins);
+  for (uint32_t b = 0; b < num_bins; ++b) {
+    uint32_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in) return false;
+    stamps[b].resize(count);
+    if (count > 0) in.read(reinterpret_cast<char*>(&stamps[b][0]), count * sizeof(CellOffset));
+    if (!in) return false;
+  }
+
+  theta_step_ = theta_step;
+  stamps_.swap(stamps);
+  return true;
+}
+
+bool FootprintStampLibrary::Save(const std::string& file) const {
+  std::ofstream out(file.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) return false;
+
+  uint32_t magic = kStampFileMagic;
+  uint64_t signature = Signature();
+  uint32_t num_bins = stamps_.size();
+  out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+  out.write(reinterpret_cast<const char*>(&signature), sizeof(signature));
+  out.write(reinterpret_cast<const char*>(&theta_step_), sizeof(theta_step_));
+  out.write(reinterpret_cast<const char*>(&num_bins), sizeof(num_bins));
+  for (uint32_t b = 0; b < num_bins; ++b) {
+    uint32_t count = stamps_[b].size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    if (count > 0) out.write(reinterpret_cast<const char*>(&stamps_[b][0]), count * sizeof(CellOffset));
+  }
+  return static_cast<bool>(out);
+}
+
+};  // namespace fixpattern_local_planner
@@ -0,0 +1,389 @@
+/* Copyright(C) Gaussian Automation. All rights reserved.
+ */
+
+/**
+ * @file local_planner_benchmark.cpp
+ * @brief offline latency benchmark of the local planners and critics on synthetic costmaps
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-28
+ */
+
+#include <fixpattern_local_planner/trajectory_planner.h>
+#include <fixpattern_local_planner/look_ahead_planner.h>
+#include <fixpattern_local_planner/costmap_model.h>
+#include <fixpattern_local_planner/footprint_stamp_library.h>
+#include <fixpattern_local_planner/line_iterator.h>
+#include <fixpattern_local_planner/obstacle_cost_function.h>
+#include <fixpattern_local_planner/oscillation_cost_function.h>
+#include <fixpattern_local_planner/prefer_forward_cost_function.h>
+#include <costmap_2d/costmap_2d.h>
+#include <costmap_2d/cost_values.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <tf/transform_datatypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace fixpattern_local_planner;
+
+namespace {
+
+const double kResolution = 0.05;
+const unsigned int kMapCells = 200;  // 10m x 10m
+const double kPathY = 5.0;
+
+void MarkLethal(costmap_2d::Costmap2D* costmap, double wx0, double wy0, double wx1, double wy1) {
+  for (double y = wy0; y <= wy1; y += 0.5 * kResolution) {
+    for (double x = wx0; x <= wx1; x += 0.5 * kResolution) {
+      unsigned int mx, my;
+      if (costmap->worldToMap(x, y, mx, my)) costmap->setCost(mx, my, costmap_2d::LETHAL_OBSTACLE);
+    }
+  }
+}
+
+// corridor 1.6m wide along the path
+void BuildCorridor(costmap_2d::Costmap2D* costmap) {
+  MarkLethal(costmap, 0.0, kPathY + 0.8, 10.0, kPathY + 0.9);
+  MarkLethal(costmap, 0.0, kPathY - 0.9, 10.0, kPathY - 0.8);
+}
+
+// small boxes scattered beside the path, fixed seed so runs are comparable
+void BuildClutter(costmap_2d::Costmap2D* costmap) {
+  srand(7);
+  for (int i = 0; i < 60; ++i) {
+    double x = 2.5 + 7.0 * rand() / RAND_MAX;
+    double y = kPathY + (i % 2 ? 1.0 : -1.0) * (0.55 + 1.5 * rand() / RAND_MAX);
+    MarkLethal(costmap, x, y, x + 0.1, y + 0.1);
+  }
+}
+
+// wall across the path with a 0.9m doorway 1m ahead of the robot
+void BuildDoorway(costmap_2d::Costmap2D* costmap) {
+  MarkLethal(costmap, 3.0, 0.0, 3.1, kPathY - 0.45);
+  MarkLethal(costmap, 3.0, kPathY + 0.45, 3.1, 10.0);
+}
+
+std::vector<geometry_msgs::Point> Footprint() {
+  std::vector<geometry_msgs::Point> footprint;
+  double xs[] = {0.3, 0.3, -0.3, -0.3};
+  double ys[] = {0.25, -0.25, -0.25, 0.25};
+  for (int i = 0; i < 4; ++i) {
+    geometry_msgs::Point pt;
+    pt.x = xs[i];
+    pt.y = ys[i];
+    footprint.push_back(pt);
+  }
+  return footprint;
+}
+
+// straight plan along the scene, slightly off the robot so rollouts have to turn
+std::vector<geometry_msgs::PoseStamped> StraightPlan() {
+  std::vector<geometry_msgs::PoseStamped> plan;
+  for (double x = 2.0; x <= 9.0; x += kResolution) {
+    geometry_msgs::PoseStamped pose;
+    pose.pose.position.x = x;
+    pose.pose.position.y = kPathY;
+    pose.pose.orientation.w = 1.0;
+    plan.push_back(pose);
+  }
+  return plan;
+}
+
+tf::Stamped<tf::Pose> StampedPose(double x, double y, double theta) {
+  return tf::Stamped<tf::Pose>(tf::Pose(tf::createQuaternionFromYaw(theta), tf::Vector3(x, y, 0.0)),
+                               ros::Time(), "map");
+}
+
+double Seconds(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Scene {
+  const char* name;
+  void (*build)(costmap_2d::Costmap2D*);
+};
+
+struct StartPose {
+  double x, y, theta;
+};
+
+// coarse and uniform sweeps are compared over every start pose of a scene
+struct SweepTally {
+  int runs, mismatches, coarse_rollouts, uniform_rollouts;
+  double worst_cost_diff;
+};
+
+// trajectory library bins, same as the ros defaults
+const double kLibraryVelStep = 0.02;
+const double kLibraryVthetaStep = 0.02;
+const double kLibraryTimeStep = 0.1;
+
+// reference is the same scene planned with the uniform sweep, a coarse or lattice run
+// is only worth its latency if it picks nearly the same command
+Trajectory RunTrajectoryPlanner(const Scene& scene, const StartPose& start_pose, int coarse_vtheta_step,
+                                bool lattice, int cycles, const Trajectory* reference, int* rollouts,
+                                double* mean_latency) {
+  costmap_2d::Costmap2D costmap(kMapCells, kMapCells, kResolution, 0.0, 0.0, costmap_2d::FREE_SPACE);
+  scene.build(&costmap);
+  CostmapModel world_model(costmap);
+  TrajectoryPlanner tc(world_model, costmap, Footprint(),
+                       2.5, 2.5, 3.2, 5, 1.0, 0.025, 1.0, 0.1, 20,
+                       0.6, 0.8, 0.2, 0.5, 0.1, 1.0, -1.0, 0.4,
+                       -0.1, 0.5, 1.0, 1.5, coarse_vtheta_step);
+  if (lattice) tc.initTrajectoryLibrary(kLibraryVelStep, kLibraryVthetaStep, kLibraryTimeStep, 20000, "");
+
+  // the grid covers the whole plan, the planner gets the highlight window of it
+  std::vector<geometry_msgs::PoseStamped> plan = StraightPlan();
+  tc.UpdatePathGrid(plan);
+  plan.resize(std::min(plan.size(), static_cast<size_t>(2.5 / kResolution)));
+  tc.UpdateGoalAndPlan(plan.back(), plan);
+
+  tf::Stamped<tf::Pose> global_pose = StampedPose(start_pose.x, start_pose.y, start_pose.theta);
+  tf::Stamped<tf::Pose> global_vel = StampedPose(0.3, 0.0, 0.0);
+  tf::Stamped<tf::Pose> drive_velocities;
+  std::vector<Trajectory> all_explored;
+  Trajectory best;
+  PlannerCycleStats stats = {0, 0, 0, 0, 0, 0};
+  double total = 0.0, worst = 0.0;
+  for (int i = 0; i < cycles; ++i) {
+    all_explored.clear();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    best = tc.findBestPath(global_pose, 0.5, 1.0, 0.0, global_vel, drive_velocities, &all_explored);
+    double latency = Seconds(start);
+    total += latency;
+    if (latency > worst) worst = latency;
+    stats = tc.getCycleStats();
+  }
+
+  // progress of the chosen command, path length left from where it ends
+  double goal_dist = 0.0;
+  if (best.getPointsSize() > 0) {
+    double end_x, end_y, end_th;
+    best.getEndpoint(end_x, end_y, end_th);
+    tc.goalDistance(end_x, end_y, &goal_dist);
+  }
+  double vtheta_diff = reference ? fabs(best.thetav_ - reference->thetav_) : 0.0;
+  double cost_diff = reference ? best.cost_ - reference->cost_ : 0.0;
+  *rollouts = stats.rollouts;
+  *mean_latency = total / cycles;
+  printf("%s,%.2f:%.2f:%.2f,%s,%d,%.6f,%.6f,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+         scene.name, start_pose.x, start_pose.y - kPathY, start_pose.theta, lattice ? "lattice" : "trajectory",
+         coarse_vtheta_step, total / cycles, worst, stats.samples_considered, stats.samples_pruned, stats.rollouts,
+         stats.footprint_checks, stats.sweep_hits, best.xv_, best.thetav_, best.cost_, goal_dist,
+         vtheta_diff, cost_diff);
+
+  // critics score what the planner explored in its last cycle
+  ObstacleCostFunction obstacle_critic(&costmap);
+  obstacle_critic.setFootprint(Footprint());
+  obstacle_critic.setParams(0.5, 0.2, 0.25);
+  OscillationCostFunction oscillation_critic;
+  oscillation_critic.resetOscillationFlags();
+  oscillation_critic.setOscillationResetDist(0.05, 0.2);
+  PreferForwardCostFunction prefer_forward_critic(1.0);
+  total = 0.0;
+  worst = 0.0;
+  int valid = 0;
+  for (int i = 0; i < cycles; ++i) {
+    valid = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t j = 0; j < all_explored.size(); ++j) {
+      Trajectory& traj = all_explored[j];
+      if (obstacle_critic.scoreTrajectory(traj) >= 0 && oscillation_critic.scoreTrajectory(traj) >= 0 &&
+          prefer_forward_critic.scoreTrajectory(traj) >= 0) {
+        ++valid;
+      }
+    }
+    double latency = Seconds(start);
+    total += latency;
+    if (latency > worst) worst = latency;
+  }
+  printf("%s,%.2f:%.2f:%.2f,critics,%d,%.6f,%.6f,%d,0,%d,0,0,0.000,0.000,0.000,0.000,0.000,0.000\n",
+         scene.name, start_pose.x, start_pose.y - kPathY, start_pose.theta, coarse_vtheta_step,
+         total / cycles, worst, static_cast<int>(all_explored.size()), valid);
+  return best;
+}
+
+void RunLookAheadPlanner(const Scene& scene, int cycles) {
+  costmap_2d::Costmap2D costmap(kMapCells, kMapCells, kResolution, 0.0, 0.0, costmap_2d::FREE_SPACE);
+  scene.build(&costmap);
+  CostmapModel world_model(costmap);
+  LookAheadPlanner la(world_model, costmap, Footprint(), 0.025, 2.5, 2.5, 3.2, 0.5, 0.1, 1.0, -1.0, 0.4);
+
+  // look-ahead planner heads for the back of its plan, give it the highlight window only
+  std::vector<geometry_msgs::PoseStamped> plan = StraightPlan();
+  plan.resize(std::min(plan.size(), static_cast<size_t>(1.0 / kResolution)));
+  la.UpdatePlan(plan);
+
+  tf::Stamped<tf::Pose> global_pose = StampedPose(2.0, kPathY - 0.1, 0.1);
+  tf::Stamped<tf::Pose> global_vel = StampedPose(0.3, 0.0, 0.0);
+  tf::Stamped<tf::Pose> drive_velocities;
+  Trajectory best;
+  double total = 0.0, worst = 0.0;
+  for (int i = 0; i < cycles; ++i) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    best = la.GeneratePath(global_pose, global_vel, 0.5, 1.0, &drive_velocities);
+    double latency = Seconds(start);
+    total += latency;
+    if (latency > worst) worst = latency;
+  }
+  printf("%s,2.00:-0.10:0.10,lookahead,0,%.6f,%.6f,0,0,1,0,0,%.3f,%.3f,%.3f,0.000,0.000,0.000\n", scene.name,
+         total / cycles, worst, best.xv_, best.thetav_, best.cost_);
+}
+
+// cells CostmapModel::footprintCost reads for a pose
+void RasterizedCells(const costmap_2d::Costmap2D& costmap, double x, double y, double theta,
+                     std::vector<std::pair<int, int> >* cells) {
+  std::vector<geometry_msgs::Point> footprint = Footprint();
+  std::vector<std::pair<int, int> > vertices;
+  for (size_t i = 0; i < footprint.size(); ++i) {
+    unsigned int mx, my;
+    costmap.worldToMap(x + cos(theta) * footprint[i].x - sin(theta) * footprint[i].y,
+                       y + sin(theta) * footprint[i].x + cos(theta) * footprint[i].y, mx, my);
+    vertices.push_back(std::make_pair(static_cast<int>(mx), static_cast<int>(my)));
+  }
+  cells->clear();
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const std::pair<int, int>& v0 = vertices[i];
+    const std::pair<int, int>& v1 = vertices[(i + 1) % vertices.size()];
+    for (LineIterator line(v0.first, v0.second, v1.first, v1.second); line.isValid(); line.advance()) {
+      cells->push_back(std::make_pair(line.getX(), line.getY()));
+    }
+  }
+}
+
+// a stamp must hold every cell the exact rasterization hits, put a single lethal
+// cell on each of them in turn for random poses and count the ones the stamp misses
+void RunStampCheck(int poses) {
+  costmap_2d::Costmap2D costmap(kMapCells, kMapCells, kResolution, 0.0, 0.0, costmap_2d::FREE_SPACE);
+  CostmapModel world_model(costmap);
+  std::vector<geometry_msgs::Point> footprint = Footprint();
+  FootprintStampLibrary stamps;
+  stamps.Initialize(footprint, kResolution, "");
+
+  srand(11);
+  std::vector<std::pair<int, int> > cells;
+  int checked = 0, missed = 0, stamp_cells = 0, rasterized_cells = 0;
+  double stamp_time = 0.0, rasterize_time = 0.0;
+  for (int i = 0; i < poses; ++i) {
+    double x = 4.0 + 2.0 * rand() / RAND_MAX;
+    double y = 4.0 + 2.0 * rand() / RAND_MAX;
+    double theta = -M_PI + 2.0 * M_PI * rand() / RAND_MAX;
+    RasterizedCells(costmap, x, y, theta, &cells);
+    rasterized_cells += cells.size();
+    for (size_t j = 0; j < cells.size(); ++j) {
+      costmap.setCost(cells[j].first, cells[j].second, costmap_2d::LETHAL_OBSTACLE);
+      ++checked;
+      if (stamps.FootprintCost(costmap, x, y, theta) >= 0.0) ++missed;
+      costmap.setCost(cells[j].first, cells[j].second, costmap_2d::FREE_SPACE);
+    }
+
+    stamp_cells += stamps.Stamp(theta).size();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    stamps.FootprintCost(costmap, x, y, theta);
+    stamp_time += Seconds(start);
+    start = std::chrono::steady_clock::now();
+    world_model.footprintCost(x, y, theta, footprint);
+    rasterize_time += Seconds(start);
+  }
+  printf("# footprint stamps: %d poses, %d rasterized cells checked, %d missed, "
+         "mean %.1f stamp cells vs %.1f rasterized, lookup %.2fus vs rasterization %.2fus\n",
+         poses, checked, missed, static_cast<double>(stamp_cells) / poses,
+         static_cast<double>(rasterized_cells) / poses, 1e6 * stamp_time / poses, 1e6 * rasterize_time / poses);
+}
+
+}  // namespace
+
+// usage: local_planner_benchmark [cycles] [coarse_vtheta_step ...]
+// every scene runs TrajectoryPlanner from a grid of start poses with a uniform vtheta
+// sweep, with each coarse step given and with the trajectory library, the critics on
+// its explored trajectories, and LookAheadPlanner. Coarse and lattice rows report how far
+// their command and cost are from the uniform one, and summary lines per scene count
+// the poses where they picked a different vtheta. Last a line checks footprint stamps
+// against the exact rasterization
+int main(int argc, char** argv) {
+  int cycles = argc > 1 ? atoi(argv[1]) : 200;
+  if (cycles <= 0) cycles = 200;
+  std::vector<int> coarse_steps(1, 1);
+  for (int i = 2; i < argc; ++i) {
+    if (atoi(argv[i]) > 1) coarse_steps.push_back(atoi(argv[i]));
+  }
+  if (coarse_steps.size() == 1) coarse_steps.push_back(3);
+
+  std::vector<StartPose> start_poses;
+  double xs[] = {2.0, 2.4};
+  double offsets[] = {-0.3, -0.1, 0.1, 0.3};
+  double headings[] = {-0.5, 0.0, 0.5};
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      for (int k = 0; k < 3; ++k) {
+        StartPose pose = {xs[i], kPathY + offsets[j], headings[k]};
+        start_poses.push_back(pose);
+      }
+    }
+  }
+
+  printf("scene,start,planner,coarse_vtheta_step,mean_latency,max_latency,considered,pruned,rollouts,"
+         "footprint_checks,sweep_hits,vx,vtheta,cost,goal_dist,vtheta_diff,cost_diff\n");
+  Scene scenes[] = {{"corridor", BuildCorridor}, {"clutter", BuildClutter}, {"doorway", BuildDoorway}};
+  for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); ++s) {
+    std::vector<SweepTally> tallies(coarse_steps.size());
+    for (size_t i = 0; i < tallies.size(); ++i) {
+      SweepTally tally = {0, 0, 0, 0, 0.0};
+      tallies[i] = tally;
+    }
+    SweepTally lattice_tally = {0, 0, 0, 0, 0.0};
+    double uniform_latency_sum = 0.0, lattice_latency_sum = 0.0;
+    for (size_t p = 0; p < start_poses.size(); ++p) {
+      int uniform_rollouts = 0;
+      double uniform_latency = 0.0;
+      Trajectory uniform = RunTrajectoryPlanner(scenes[s], start_poses[p], 1, false, cycles, NULL,
+                                                &uniform_rollouts, &uniform_latency);
+      for (size_t i = 1; i < coarse_steps.size(); ++i) {
+        int coarse_rollouts = 0;
+        double coarse_latency = 0.0;
+        Trajectory coarse = RunTrajectoryPlanner(scenes[s], start_poses[p], coarse_steps[i], false, cycles,
+                                                 &uniform, &coarse_rollouts, &coarse_latency);
+        SweepTally& tally = tallies[i];
+        ++tally.runs;
+        if (fabs(coarse.thetav_ - uniform.thetav_) > 1e-3 || (coarse.cost_ < 0) != (uniform.cost_ < 0)) {
+          ++tally.mismatches;
+        }
+        tally.coarse_rollouts += coarse_rollouts;
+        tally.uniform_rollouts += uniform_rollouts;
+        if (coarse.cost_ >= 0 && uniform.cost_ >= 0 && coarse.cost_ - uniform.cost_ > tally.worst_cost_diff) {
+          tally.worst_cost_diff = coarse.cost_ - uniform.cost_;
+        }
+      }
+
+      // lattice commands are snapped to the library bins, differing by less than a bin is the same command
+      int lattice_rollouts = 0;
+      double lattice_latency = 0.0;
+      Trajectory lattice = RunTrajectoryPlanner(scenes[s], start_poses[p], 1, true, cycles,
+                                                &uniform, &lattice_rollouts, &lattice_latency);
+      ++lattice_tally.runs;
+      if (fabs(lattice.thetav_ - uniform.thetav_) > kLibraryVthetaStep || (lattice.cost_ < 0) != (uniform.cost_ < 0)) {
+        ++lattice_tally.mismatches;
+      }
+      uniform_latency_sum += uniform_latency;
+      lattice_latency_sum += lattice_latency;
+    }
+    RunLookAheadPlanner(scenes[s], cycles);
+    for (size_t i = 1; i < tallies.size(); ++i) {
+      printf("# %s coarse_vtheta_step %d: %d/%d poses picked a different command, "
+             "mean rollouts %.1f vs %.1f uniform, worst cost increase %.3f\n",
+             scenes[s].name, coarse_steps[i], tallies[i].mismatches, tallies[i].runs,
+             static_cast<double>(tallies[i].coarse_rollouts) / tallies[i].runs,
+             static_cast<double>(tallies[i].uniform_rollouts) / tallies[i].runs, tallies[i].worst_cost_diff);
+    }
+    printf("# %s lattice: %d/%d poses picked a command more than a bin away, mean latency %.6f vs %.6f uniform\n",
+           scenes[s].name, lattice_tally.mismatches, lattice_tally.runs,
+           lattice_latency_sum / lattice_tally.runs, uniform_latency_sum / lattice_tally.runs);
+  }
+  RunStampCheck(2000);
+  return 0;
+}
@@ -38,7 +38,12 @@
 
 namespace fixpattern_local_planner {
 
-OdometryHelperRos::OdometryHelperRos(std::string odom_topic) {
+const size_t OdometryHelperRos::kFrameIdCapacity;
+
+OdometryHelperRos::OdometryHelperRos(std::string odom_topic)
+  : odom_seq_(0), vx_(0.0), vy_(0.0), vth_(0.0),
+    filtered_vx_(0.0), filtered_vy_(0.0), filtered_vth_(0.0),
+    child_frame_id_size_(0), odom_received_(false), filter_alpha_(0.5) {
   setOdomTopic( odom_topic );
 }
 
@@ -46,37 +51,100 @@ void OdometryHelperRos::odomCallback(const nav_msgs::Odometry::ConstPtr& msg) {
   GAUSSIAN_INFO_ONCE("odom received!");
 
   //we assume that the odometry is published in the frame of the base
-  boost::mutex::scoped_lock lock(odom_mutex_);
-  base_odom_.twist.twist.linear.x = msg->twist.twist.linear.x;
-  base_odom_.twist.twist.linear.y = msg->twist.twist.linear.y;
-  base_odom_.twist.twist.angular.z = msg->twist.twist.angular.z;
-  base_odom_.child_frame_id = msg->child_frame_id;
+  double vx = msg->twist.twist.linear.x;
+  double vy = msg->twist.twist.linear.y;
+  double vth = msg->twist.twist.angular.z;
+
+  // filter the jitter of odometry, start from the first message
+  double alpha = odom_received_ ? filter_alpha_ : 1.0;
+  double filtered_vx = alpha * vx + (1.0 - alpha) * filtered_vx_.load(std::memory_order_relaxed);
+  double filtered_vy = alpha * vy + (1.0 - alpha) * filtered_vy_.load(std::memory_order_relaxed);
+  double filtered_vth = alpha * vth + (1.0 - alpha) * filtered_vth_.load(std::memory_order_relaxed);
+  odom_received_ = true;
+
+  // frame id hardly ever changes, only rewrite it when it does
+  bool frame_changed = msg->child_frame_id != last_child_frame_id_;
+  if (frame_changed) {
+    last_child_frame_id_ = msg->child_frame_id;
+    if (last_child_frame_id_.size() > kFrameIdCapacity) {
+      GAUSSIAN_WARN("odom child_frame_id %s is truncated to %zu chars", last_child_frame_id_.c_str(), kFrameIdCapacity);
+    }
+  }
+
+  // single writer, so no need to compare and swap
+  unsigned int seq = odom_seq_.load(std::memory_order_relaxed);
+  odom_seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  vx_.store(vx, std::memory_order_relaxed);
+  vy_.store(vy, std::memory_order_relaxed);
+  vth_.store(vth, std::memory_order_relaxed);
+  filtered_vx_.store(filtered_vx, std::memory_order_relaxed);
+  filtered_vy_.store(filtered_vy, std::memory_order_relaxed);
+  filtered_vth_.store(filtered_vth, std::memory_order_relaxed);
+  if (frame_changed) {
+    size_t size = std::min(last_child_frame_id_.size(), kFrameIdCapacity);
+    for (size_t i = 0; i < size; ++i) {
+      child_frame_id_[i].store(last_child_frame_id_[i], std::memory_order_relaxed);
+    }
+    child_frame_id_size_.store(size, std::memory_order_relaxed);
+  }
+  odom_seq_.store(seq + 2, std::memory_order_release);
 //  ROS_DEBUG_NAMED("dwa_local_planner", "In the odometry callback with velocity values: (%.2f, %.2f, %.2f)",
-//      base_odom_.twist.twist.linear.x, base_odom_.twist.twist.linear.y, base_odom_.twist.twist.angular.z);
+//      vx, vy, vth);
+}
+
+OdometryHelperRos::OdomSnapshot OdometryHelperRos::readSnapshot() const {
+  OdomSnapshot snapshot;
+  unsigned int seq_begin, seq_end;
+  do {
+    seq_begin = odom_seq_.load(std::memory_order_acquire);
+    snapshot.vx = vx_.load(std::memory_order_relaxed);
+    snapshot.vy = vy_.load(std::memory_order_relaxed);
+    snapshot.vth = vth_.load(std::memory_order_relaxed);
+    snapshot.filtered_vx = filtered_vx_.load(std::memory_order_relaxed);
+    snapshot.filtered_vy = filtered_vy_.load(std::memory_order_relaxed);
+    snapshot.filtered_vth = filtered_vth_.load(std::memory_order_relaxed);
+    snapshot.child_frame_id_size = child_frame_id_size_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < snapshot.child_frame_id_size; ++i) {
+      snapshot.child_frame_id[i] = child_frame_id_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    seq_end = odom_seq_.load(std::memory_order_relaxed);
+  } while ((seq_begin & 1) || seq_begin != seq_end);
+  return snapshot;
 }
 
 //copy over the odometry information
 void OdometryHelperRos::getOdom(nav_msgs::Odometry& base_odom) {
-  boost::mutex::scoped_lock lock(odom_mutex_);
-  base_odom = base_odom_;
+  OdomSnapshot snapshot = readSnapshot();
+  base_odom.twist.twist.linear.x = snapshot.vx;
+  base_odom.twist.twist.linear.y = snapshot.vy;
+  base_odom.twist.twist.angular.z = snapshot.vth;
+  base_odom.child_frame_id.assign(snapshot.child_frame_id, snapshot.child_frame_id_size);
 }
 
-
 void OdometryHelperRos::getRobotVel(tf::Stamped<tf::Pose>& robot_vel) {
   // Set current velocities from odometry
-  geometry_msgs::Twist global_vel;
-  {
-    boost::mutex::scoped_lock lock(odom_mutex_);
-    global_vel.linear.x = base_odom_.twist.twist.linear.x;
-    global_vel.linear.y = base_odom_.twist.twist.linear.y;
-    global_vel.angular.z = base_odom_.twist.twist.angular.z;
-
-    robot_vel.frame_id_ = base_odom_.child_frame_id;
-  }
-  robot_vel.setData(tf::Transform(tf::createQuaternionFromYaw(global_vel.angular.z), tf::Vector3(global_vel.linear.x, global_vel.linear.y, 0)));
+  OdomSnapshot snapshot = readSnapshot();
+  robot_vel.frame_id_.assign(snapshot.child_frame_id, snapshot.child_frame_id_size);
+  robot_vel.setData(tf::Transform(tf::createQuaternionFromYaw(snapshot.vth), tf::Vector3(snapshot.vx, snapshot.vy, 0)));
   robot_vel.stamp_ = ros::Time();
 }
 
+void OdometryHelperRos::getRobotVel(double* vx, double* vy, double* vth) {
+  OdomSnapshot snapshot = readSnapshot();
+  *vx = snapshot.vx;
+  *vy = snapshot.vy;
+  *vth = snapshot.vth;
+}
+
+void OdometryHelperRos::getFilteredRobotVel(double* vx, double* vy, double* vth) {
+  OdomSnapshot snapshot = readSnapshot();
+  *vx = snapshot.filtered_vx;
+  *vy = snapshot.filtered_vy;
+  *vth = snapshot.filtered_vth;
+}
+
 void OdometryHelperRos::setOdomTopic(std::string odom_topic)
 {
   if( odom_topic != odom_topic_ )
@@ -0,0 +1,187 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+ */
+
+/**
+ * @file path_distance_grid.cpp
+ * @brief grid of nearest plan pose, gives path and goal distance with array reads
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#include <fixpattern_local_planner/path_distance_grid.h>
+
+#include <cmath>
+#include <cfloat>
+#include <queue>
+#include <vector>
+#include <algorithm>
+
+namespace fixpattern_local_planner {
+
+// plan poses are copies of path poses, only transformed by identity
+const double kSamePoseDistance = 1e-6;
+
+PathDistanceGrid::PathDistanceGrid()
+  : origin_x_(0.0), origin_y_(0.0), resolution_(0.1), size_x_(0), size_y_(0),
+    begin_(0), end_(0) { }
+
+PathDistanceGrid::~PathDistanceGrid() { }
+
+void PathDistanceGrid::Clear() {
+  size_x_ = size_y_ = 0;
+  nearest_.clear();
+  dist_.clear();
+  px_.clear();
+  py_.clear();
+  remaining_.clear();
+  begin_ = end_ = 0;
+}
+
+void PathDistanceGrid::Build(const std::vector<geometry_msgs::PoseStamped>& path,
+                             double resolution, double padding) {
+  Clear();
+  if (path.empty() || resolution <= 0.0) return;
+  resolution_ = resolution;
+
+  px_.resize(path.size());
+  py_.resize(path.size());
+  remaining_.resize(path.size());
+  double min_x = path.front().pose.position.x, max_x = min_x;
+  double min_y = path.front().pose.position.y, max_y = min_y;
+  for (unsigned int i = 0; i < path.size(); ++i) {
+    px_[i] = path[i].pose.position.x;
+    py_[i] = path[i].pose.position.y;
+    min_x = std::min(min_x, px_[i]);
+    max_x = std::max(max_x, px_[i]);
+    min_y = std::min(min_y, py_[i]);
+    max_y = std::max(max_y, py_[i]);
+  }
+  remaining_.back() = 0.0;
+  for (int i = static_cast<int>(path.size()) - 2; i >= 0; --i) {
+    remaining_[i] = remaining_[i + 1] + hypot(px_[i + 1] - px_[i], py_[i + 1] - py_[i]);
+  }
+  begin_ = 0;
+  end_ = static_cast<int>(path.size());
+
+  origin_x_ = min_x - padding;
+  origin_y_ = min_y - padding;
+  size_x_ = static_cast<int>(ceil((max_x - min_x + 2.0 * padding) / resolution_)) + 1;
+  size_y_ = static_cast<int>(ceil((max_y - min_y + 2.0 * padding) / resolution_)) + 1;
+  nearest_.assign(size_x_ * size_y_, -1);
+  dist_.assign(nearest_.size(), FLT_MAX);
+  std::vector<float>& dist = dist_;
+
+  // seed cells holding path poses, then propagate nearest index to neighbours
+  // as long as it gets a cell closer than what it has, within padding of the path
+  std::queue<int> open;
+  for (unsigned int i = 0; i < path.size(); ++i) {
+    int mx = static_cast<int>((px_[i] - origin_x_) / resolution_);
+    int my = static_cast<int>((py_[i] - origin_y_) / resolution_);
+    int index = my * size_x_ + mx;
+    float d = hypot(origin_x_ + (mx + 0.5) * resolution_ - px_[i], origin_y_ + (my + 0.5) * resolution_ - py_[i]);
+    if (d < dist[index]) {
+      if (nearest_[index] < 0) open.push(index);
+      dist[index] = d;
+      nearest_[index] = i;
+    }
+  }
+
+  while (!open.empty()) {
+    int index = open.front();
+    open.pop();
+    int mx = index % size_x_, my = index / size_x_;
+    int nearest = nearest_[index];
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        int nx = mx + dx, ny = my + dy;
+        if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= size_x_ || ny >= size_y_) continue;
+        int n_index = ny * size_x_ + nx;
+        float d = hypot(origin_x_ + (nx + 0.5) * resolution_ - px_[nearest],
+                        origin_y_ + (ny + 0.5) * resolution_ - py_[nearest]);
+        if (d < dist[n_index] && d <= padding) {
+          dist[n_index] = d;
+          nearest_[n_index] = nearest;
+          open.push(n_index);
+        }
+      }
+    }
+  }
+}
+
+bool PathDistanceGrid::SetPlanRange(const std::vector<geometry_msgs::PoseStamped>& plan) {
+  int size = static_cast<int>(px_.size());
+  if (plan.empty() || size == 0) {
+    begin_ = end_ = 0;
+    return false;
+  }
+  // plan is only pruned forward, so look from the current range on first
+  double x = plan.front().pose.position.x, y = plan.front().pose.position.y;
+  int begin = -1;
+  for (int i = begin_; i < size && begin < 0; ++i) {
+    if (fabs(px_[i] - x) < kSamePoseDistance && fabs(py_[i] - y) < kSamePoseDistance) begin = i;
+  }
+  for (int i = 0; i < std::min(begin_, size) && begin < 0; ++i) {
+    if (fabs(px_[i] - x) < kSamePoseDistance && fabs(py_[i] - y) < kSamePoseDistance) begin = i;
+  }
+  // plan extended past the end of path, or changed since the grid was built
+  int end = begin + static_cast<int>(plan.size());
+  if (begin < 0 || end > size ||
+      fabs(px_[end - 1] - plan.back().pose.position.x) >= kSamePoseDistance ||
+      fabs(py_[end - 1] - plan.back().pose.position.y) >= kSamePoseDistance) {
+    begin_ = end_ = 0;
+    return false;
+  }
+  begin_ = begin;
+  end_ = end;
+  return true;
+}
+
+int PathDistanceGrid::NearestIndex(double x, double y, double* dist) const {
+  if (begin_ >= end_ || x < origin_x_ || y < origin_y_) return -1;
+  int mx = static_cast<int>((x - origin_x_) / resolution_);
+  int my = static_cast<int>((y - origin_y_) / resolution_);
+  if (mx >= size_x_ || my >= size_y_) return -1;
+  int index = my * size_x_ + mx;
+  int nearest = nearest_[index];
+  if (nearest < 0) return -1;
+  // a cell nearest to a part of path already passed or not reached yet is mostly
+  // nearest to the plan end on that side, checked below
+  bool clamped = nearest < begin_ || nearest >= end_;
+  nearest = std::max(begin_, std::min(end_ - 1, nearest));
+
+  // cell keeps the pose nearest to its centre, the point may be nearer to the next one
+  *dist = hypot(x - px_[nearest], y - py_[nearest]);
+  int best = nearest;
+  if (nearest > begin_) {
+    double d = hypot(x - px_[nearest - 1], y - py_[nearest - 1]);
+    if (d < *dist) {
+      *dist = d;
+      best = nearest - 1;
+    }
+  }
+  if (nearest + 1 < end_) {
+    double d = hypot(x - px_[nearest + 1], y - py_[nearest + 1]);
+    if (d < *dist) {
+      *dist = d;
+      best = nearest + 1;
+    }
+  }
+  // no pose of path is closer to the point than cell distance less half a cell
+  // diagonal, past one cell more than that the plan may come back closer
+  if (clamped && *dist - (dist_[index] - 0.71 * resolution_) > resolution_) return -1;
+  return best;
+}
+
+bool PathDistanceGrid::PathDistance(double x, double y, double* dist) const {
+  return NearestIndex(x, y, dist) >= 0;
+}
+
+bool PathDistanceGrid::GoalDistance(double x, double y, double* dist) const {
+  int nearest = NearestIndex(x, y, dist);
+  if (nearest < 0) return false;
+  *dist += remaining_[nearest];
+  return true;
+}
+
+};  // namespace fixpattern_local_planner
@@ -0,0 +1,188 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+ */
+
+/**
+ * @file trajectory_library.cpp
+ * @brief rollouts relative to the start pose indexed by velocity and command bins, replaces online integration
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#include <fixpattern_local_planner/trajectory_library.h>
+
+#include <cmath>
+#include <fstream>
+#include <vector>
+#include <string>
+
+namespace fixpattern_local_planner {
+
+namespace {
+
+const uint32_t kLibraryFileMagic = 0x4c545046;  // "FPTL"
+
+// key fields, velocity bins are signed and stored with an offset
+const int kVelocityBits = 11;
+const int kTimeBits = 10;
+const int kStepsBits = 10;
+
+uint64_t HashBytes(uint64_t seed, const void* data, size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    seed ^= bytes[i];
+    seed *= 1099511628211ULL;
+  }
+  return seed;
+}
+
+// appends value to key, false if it doesn't fit in bits
+bool PackField(int value, int bits, bool is_signed, uint64_t* key) {
+  if (is_signed) value += 1 << (bits - 1);
+  if (value < 0 || value >= (1 << bits)) return false;
+  *key = (*key << bits) | static_cast<uint64_t>(value);
+  return true;
+}
+
+}  // namespace
+
+const uint64_t TrajectoryLibrary::kInvalidKey;
+
+TrajectoryLibrary::TrajectoryLibrary()
+  : vel_step_(0.0), vtheta_step_(0.0), time_step_(0.0), acc_x_(0.0), acc_theta_(0.0),
+    max_entries_(0), hits_(0), misses_(0) { }
+
+TrajectoryLibrary::~TrajectoryLibrary() { }
+
+bool TrajectoryLibrary::Initialize(double vel_step, double vtheta_step, double time_step,
+                                   double acc_x, double acc_theta, unsigned int max_entries,
+                                   const std::string& file) {
+  entries_.clear();
+  hits_ = misses_ = 0;
+  vel_step_ = 0.0;
+  if (vel_step <= 0.0 || vtheta_step <= 0.0 || time_step <= 0.0 || max_entries == 0) {
+    GAUSSIAN_WARN("[TRAJECTORY LIBRARY] invalid bins, library disabled");
+    return false;
+  }
+  vel_step_ = vel_step;
+  vtheta_step_ = vtheta_step;
+  time_step_ = time_step;
+  acc_x_ = acc_x;
+  acc_theta_ = acc_theta;
+  max_entries_ = max_entries;
+  file_ = file;
+
+  if (!file_.empty() && Load()) {
+    GAUSSIAN_INFO("[TRAJECTORY LIBRARY] loaded %zu entries from %s", entries_.size(), file_.c_str());
+  }
+  return true;
+}
+
+uint64_t TrajectoryLibrary::Snap(double* vx, double* vtheta, double* vx_samp, double* vtheta_samp,
+                                 double* sim_time, int num_steps) const {
+  int vx_bin = static_cast<int>(floor(*vx / vel_step_ + 0.5));
+  int vtheta_bin = static_cast<int>(floor(*vtheta / vtheta_step_ + 0.5));
+  int vx_samp_bin = static_cast<int>(floor(*vx_samp / vel_step_ + 0.5));
+  int vtheta_samp_bin = static_cast<int>(floor(*vtheta_samp / vtheta_step_ + 0.5));
+  // never roll out shorter than asked
+  int time_bin = static_cast<int>(ceil(*sim_time / time_step_ - 1e-6));
+
+  uint64_t key = 0;
+  if (!PackField(vx_bin, kVelocityBits, true, &key) || !PackField(vtheta_bin, kVelocityBits, true, &key) ||
+      !PackField(vx_samp_bin, kVelocityBits, true, &key) || !PackField(vtheta_samp_bin, kVelocityBits, true, &key) ||
+      !PackField(time_bin, kTimeBits, false, &key) || time_bin == 0 ||
+      !PackField(num_steps, kStepsBits, false, &key)) {
+    return kInvalidKey;
+  }
+  *vx = vx_bin * vel_step_;
+  *vtheta = vtheta_bin * vtheta_step_;
+  *vx_samp = vx_samp_bin * vel_step_;
+  *vtheta_samp = vtheta_samp_bin * vtheta_step_;
+  *sim_time = time_bin * time_step_;
+  return key;
+}
+
+const std::vector<TrajectoryLibrary::RelativePose>* TrajectoryLibrary::Find(uint64_t key) {
+  std::unordered_map<uint64_t, std::vector<RelativePose> >::const_iterator it = entries_.find(key);
+  if (it == entries_.end()) {
+    ++misses_;
+    return NULL;
+  }
+  ++hits_;
+  return &it->second;
+}
+
+const std::vector<TrajectoryLibrary::RelativePose>* TrajectoryLibrary::Insert(
+    uint64_t key, const std::vector<RelativePose>& poses) {
+  if (entries_.size() >= max_entries_) {
+    GAUSSIAN_INFO_ONCE("[TRAJECTORY LIBRARY] library is full with %zu entries, new commands are integrated online",
+                       entries_.size());
+    return NULL;
+  }
+  std::vector<RelativePose>& entry = entries_[key];
+  entry = poses;
+  return &entry;
+}
+
+uint64_t TrajectoryLibrary::Signature() const {
+  uint64_t seed = 14695981039346656037ULL;
+  seed = HashBytes(seed, &vel_step_, sizeof(double));
+  seed = HashBytes(seed, &vtheta_step_, sizeof(double));
+  seed = HashBytes(seed, &time_step_, sizeof(double));
+  seed = HashBytes(seed, &acc_x_, sizeof(double));
+  return HashBytes(seed, &acc_theta_, sizeof(double));
+}
+
+bool TrajectoryLibrary::Load() {
+  std::ifstream in(file_.c_str(), std::ios::binary);
+  if (!in.is_open()) return false;
+
+  uint32_t magic = 0, num_entries = 0;
+  uint64_t signature = 0;
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char*>(&signature), sizeof(signature));
+  in.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
+  if (!in || magic != kLibraryFileMagic || signature != Signature()) {
+    GAUSSIAN_INFO("[TRAJECTORY LIBRARY] %s doesn't match bins or acceleration, start empty", file_.c_str());
+    return false;
+  }
+
+  std::unordered_map<uint64_t, std::vector<RelativePose> > entries;
+  for (uint32_t i = 0; i < num_entries && entries.size() < max_entries_; ++i) {
+    uint64_t key = 0;
+    uint32_t count = 0;
+    in.read(reinterpret_cast<char*>(&key), sizeof(key));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in) return false;
+    std::vector<RelativePose>& poses = entries[key];
+    poses.resize(count);
+    if (count > 0) in.read(reinterpret_cast<char*>(&poses[0]), count * sizeof(RelativePose));
+    if (!in) return false;
+  }
+
+  entries_.swap(entries);
+  return true;
+}
+
+bool TrajectoryLibrary::Save() const {
+  if (file_.empty()) return false;
+  std::ofstream out(file_.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) return false;
+
+  uint32_t magic = kLibraryFileMagic;
+  uint64_t signature = Signature();
+  uint32_t num_entries = entries_.size();
+  out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+  out.write(reinterpret_cast<const char*>(&signature), sizeof(signature));
+  out.write(reinterpret_cast<const char*>(&num_entries), sizeof(num_entries));
+  std::unordered_map<uint64_t, std::vector<RelativePose> >::const_iterator it;
+  for (it = entries_.begin(); it != entries_.end(); ++it) {
+    uint32_t count = it->second.size();
+    out.write(reinterpret_cast<const char*>(&it->first), sizeof(it->first));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    if (count > 0) out.write(reinterpret_cast<const char*>(&it->second[0]), count * sizeof(RelativePose));
+  }
+  return static_cast<bool>(out);
+}
+
+};  // namespace fixpattern_local_planner
@@ -22,6 +22,7 @@
 #include <queue>
 #include <vector>
 #include <algorithm>
+#include <utility>
 
 #include <Eigen/Dense>
 
@@ -39,42 +40,60 @@ TrajectoryPlanner::TrajectoryPlanner(WorldModel& world_model,
                                      double max_vel_x, double min_vel_x,
                                      double max_vel_th, double min_vel_th, double min_in_place_vel_th,
                                      double backup_vel, double min_hightlight_dis, 
-                                     double final_vel_ratio, double final_goal_dis_th)
+                                     double final_vel_ratio, double final_goal_dis_th,
+                                     int coarse_vtheta_step)
   : costmap_(costmap),
     world_model_(world_model), footprint_spec_(footprint_spec),
     num_calc_footprint_cost_(num_calc_footprint_cost),
-    sim_time_(sim_time), sim_granularity_(sim_granularity),
-    front_safe_sim_time_(front_safe_sim_time), front_safe_sim_granularity_(front_safe_sim_granularity),
-    vtheta_samples_(vtheta_samples),
-    pdist_scale_(pdist_scale), gdist_scale_(gdist_scale), occdist_scale_(occdist_scale),
+    vtheta_samples_(vtheta_samples), gdist_scale_(gdist_scale),
     acc_lim_x_(acc_lim_x), acc_lim_y_(acc_lim_y), acc_lim_theta_(acc_lim_theta),
-    max_vel_x_(max_vel_x), min_vel_x_(min_vel_x),
-    max_vel_th_(max_vel_th), min_vel_th_(min_vel_th), min_in_place_vel_th_(min_in_place_vel_th),
+    min_vel_x_(min_vel_x), min_vel_th_(min_vel_th), min_in_place_vel_th_(min_in_place_vel_th),
     backup_vel_(backup_vel), min_hightlight_dis_(min_hightlight_dis), 
-    final_vel_ratio_(final_vel_ratio), final_goal_dis_th_(final_goal_dis_th) {
+    final_vel_ratio_(final_vel_ratio), final_goal_dis_th_(final_goal_dis_th),
+    front_sweep_active_(false), coarse_vtheta_step_(coarse_vtheta_step),
+    samples_considered_(0), samples_pruned_(0), samples_rolled_out_(0), samples_bounded_(0),
+    footprint_checks_(0), sweep_hits_(0),
+    last_best_vtheta_(0.0), last_best_valid_(false),
+    clearance_x_(0.0), clearance_y_(0.0), clearance_theta_(0.0) {
+
+  config_.sim_time = sim_time;
+  config_.sim_granularity = sim_granularity;
+  config_.front_safe_sim_time = front_safe_sim_time;
+  config_.front_safe_sim_granularity = front_safe_sim_granularity;
+  config_.pdist_scale = pdist_scale;
+  config_.occdist_scale = occdist_scale;
+  config_.max_vel_x = max_vel_x;
+  config_.max_vel_th = max_vel_th;
 
   costmap_2d::calculateMinAndMaxDistances(footprint_spec_, inscribed_radius_, circumscribed_radius_);
+
+  // no clearance until updateClearance gives a pose
+  front_clearance_.dis = rear_clearance_.dis = 0.0;
+  front_clearance_.blocked = rear_clearance_.blocked = true;
 }
 
-TrajectoryPlanner::~TrajectoryPlanner() { }
-/*
-void TrajectoryPlanner::SetParameters(double max_vel_x, double max_vel_theta, double sim_time) {
-  boost::mutex::scoped_lock l(configuration_mutex_);
-  max_vel_x_ = max_vel_x;
-  max_vel_theta_ = max_vel_theta;
-  sim_time_ = sim_time;
+TrajectoryPlanner::~TrajectoryPlanner() {
+  if (trajectory_library_.IsInitialized()) {
+    GAUSSIAN_INFO("[TRAJECTORY PLANNER] trajectory library served %u of %u rollouts, %zu entries",
+                  trajectory_library_.hits(), trajectory_library_.hits() + trajectory_library_.misses(),
+                  trajectory_library_.size());
+    trajectory_library_.Save();
+  }
 }
-*/
+
 void TrajectoryPlanner::CalculatePathCost(
+    const TrajectoryPlannerConfig& config,
     double x, double y, double theta,
     double vx, double vy, double vtheta,
     double vx_samp, double vy_samp, double vtheta_samp,
     double acc_x, double acc_y, double acc_theta,
     double impossible_cost,
     Trajectory& traj, double sim_time) {
-
-  // make sure the configuration doesn't change mid run
-  boost::mutex::scoped_lock l(configuration_mutex_);
+  // discard trajectory that is circle
+  if (fabs(vtheta_samp) > 0.00001 && sim_time > M_PI / fabs(vtheta_samp)) {
+    traj.cost_ = DBL_MAX;
+    return;
+  }
 
   double x_i = x;
   double y_i = y;
@@ -86,13 +105,7 @@ void TrajectoryPlanner::CalculatePathCost(
   vy_i = vy;
   vtheta_i = vtheta;
 
-  // discard trajectory that is circle
-  if (fabs(vtheta_samp) > 0.00001 && sim_time > M_PI / fabs(vtheta_samp)) {
-    traj.cost_ = DBL_MAX;
-    return;
-  }
-
-  double sim_granularity = sim_time / sim_time_ * sim_granularity_;
+  double sim_granularity = sim_time / config.sim_time * config.sim_granularity;
   // compute the number of steps we must take along this trajectory to be "safe"
   int num_steps = static_cast<int>(sim_time / sim_granularity + 0.5);
 
@@ -116,14 +129,7 @@ void TrajectoryPlanner::CalculatePathCost(
 
   for (int i = 0; i < num_steps; ++i) {
     // update path and goal distances
-    double point_cost = DBL_MAX;
-    for (auto it = global_plan_.begin(); it != global_plan_.end(); ++it) {
-      double loop_cost = hypot(x_i - it->pose.position.x, y_i - it->pose.position.y);
-      if (loop_cost < point_cost) {
-        point_cost = loop_cost;
-      }
-    }
-    path_dist += point_cost;
+    path_dist += pathDistance(x_i, y_i);
 
     // the point is legal... add it to the trajectory
     traj.addPoint(x_i, y_i, theta_i);
@@ -142,22 +148,29 @@ void TrajectoryPlanner::CalculatePathCost(
     time += dt;
   }
 
-  traj.cost_ = pdist_scale_ * path_dist;
+  traj.cost_ = config.pdist_scale * path_dist;
 }
 
 /**
  * create and score a trajectory given the current pose of the robot and selected velocities
  */
 void TrajectoryPlanner::generateTrajectory(
+    const TrajectoryPlannerConfig& config,
     double x, double y, double theta,
     double vx, double vy, double vtheta,
     double vx_samp, double vy_samp, double vtheta_samp,
     double acc_x, double acc_y, double acc_theta,
     double impossible_cost,
-    Trajectory& traj, double sim_time) {
+    Trajectory& traj, double sim_time, double cost_bound,
+    const std::vector<TrajectoryLibrary::RelativePose>* lattice) {
+  traj.is_footprint_safe_ = true;
 
-  // make sure the configuration doesn't change mid run
-  boost::mutex::scoped_lock l(configuration_mutex_);
+  // discard trajectory that is circle
+  if (fabs(vtheta_samp) - 0.0 > 0.00001 && sim_time > M_PI / fabs(vtheta_samp)) {
+    traj.cost_ = -1.0;
+    // GAUSSIAN_WARN("[TRAJECTORY PLANNER] trajectory is circle, cost = -1.0, vtheta_samp: %lf, sim_time: %lf", vtheta_samp, sim_time);
+    return;
+  }
 
   double x_i = x;
   double y_i = y;
@@ -168,16 +181,8 @@ void TrajectoryPlanner::generateTrajectory(
   vx_i = vx;
   vy_i = vy;
   vtheta_i = vtheta;
-  traj.is_footprint_safe_ = true;
 
-  // discard trajectory that is circle
-  if (fabs(vtheta_samp) - 0.0 > 0.00001 && sim_time > M_PI / fabs(vtheta_samp)) {
-    traj.cost_ = -1.0;
-    // GAUSSIAN_WARN("[TRAJECTORY PLANNER] trajectory is circle, cost = -1.0, vtheta_samp: %lf, sim_time: %lf", vtheta_samp, sim_time);
-    return;
-  }
-
-  double sim_granularity = sim_time / sim_time_ * sim_granularity_;
+  double sim_granularity = sim_time / config.sim_time * config.sim_granularity;
   // compute the number of steps we must take along this trajectory to be "safe"
   int num_steps = static_cast<int>(sim_time / sim_granularity + 0.5);
 
@@ -189,6 +194,10 @@ void TrajectoryPlanner::generateTrajectory(
   double dt = sim_time / num_steps;
   double time = 0.0;
 
+  // library poses are rotated by the start heading and moved to the start position
+  if (lattice && static_cast<int>(lattice->size()) != num_steps) lattice = NULL;
+  double cos_th = cos(theta), sin_th = sin(theta);
+
   // create a potential trajectory
   traj.resetPoints();
   traj.xv_ = vx_samp;
@@ -215,8 +224,13 @@ void TrajectoryPlanner::generateTrajectory(
     // TODO(lizhen) check if it is needed
     double footprint_cost = 0.0;
     if (i < num_calc_footprint_cost_) {
-      // check the point on the trajectory for legality
-      footprint_cost = footprintCost(x_i, y_i, theta_i);
+      // check the point on the trajectory for legality, straight trajectory
+      // shares the forward sweep with checkFrontSafe
+      if (vtheta_samp == 0.0) {
+        footprint_cost = sweepFootprintCost(x_i, y_i, theta_i);
+      } else {
+        footprint_cost = footprintCost(x_i, y_i, theta_i);
+      }
 
       // if the footprint hits an obstacle this trajectory is invalid
       if (footprint_cost < 0) {
@@ -229,14 +243,7 @@ void TrajectoryPlanner::generateTrajectory(
     // get cell cost
     occ_dist += costmap_.getCost(cell_x, cell_y) / 255.0;
     // update path and goal distances
-    double point_cost = DBL_MAX;
-    for (auto it = global_plan_.begin(); it != global_plan_.end(); ++it) {
-      double loop_cost = hypot(x_i - it->pose.position.x, y_i - it->pose.position.y);
-      if (loop_cost < point_cost) {
-        point_cost = loop_cost;
-      }
-    }
-    path_dist += point_cost;
+    path_dist += pathDistance(x_i, y_i);
 
     // if a point on this trajectory has no clear path it is invalid
     if (impossible_cost <= path_dist) {
@@ -245,39 +252,81 @@ void TrajectoryPlanner::generateTrajectory(
       return;
     }
 
+    // costs only grow along the trajectory, stop once it can't beat the bound
+    if (config.pdist_scale * path_dist + config.occdist_scale * occ_dist > cost_bound) {
+      traj.cost_ = -3.0;
+      return;
+    }
+
     // the point is legal... add it to the trajectory
     traj.addPoint(x_i, y_i, theta_i);
 
-    // calculate velocities
-    vx_i = computeNewVelocity(vx_samp, vx_i, acc_x, dt);
-    vy_i = computeNewVelocity(vy_samp, vy_i, acc_y, dt);
-    vtheta_i = computeNewVelocity(vtheta_samp, vtheta_i, acc_theta, dt);
-
-    // calculate positions
-    x_i = computeNewXPosition(x_i, vx_i, vy_i, theta_i, dt);
-    y_i = computeNewYPosition(y_i, vx_i, vy_i, theta_i, dt);
-    theta_i = computeNewThetaPosition(theta_i, vtheta_i, dt);
+    if (lattice && i + 1 < num_steps) {
+      const TrajectoryLibrary::RelativePose& pose = (*lattice)[i + 1];
+      x_i = x + cos_th * pose.x - sin_th * pose.y;
+      y_i = y + sin_th * pose.x + cos_th * pose.y;
+      theta_i = theta + pose.theta;
+    } else {
+      // calculate velocities
+      vx_i = computeNewVelocity(vx_samp, vx_i, acc_x, dt);
+      vy_i = computeNewVelocity(vy_samp, vy_i, acc_y, dt);
+      vtheta_i = computeNewVelocity(vtheta_samp, vtheta_i, acc_theta, dt);
+
+      // calculate positions
+      x_i = computeNewXPosition(x_i, vx_i, vy_i, theta_i, dt);
+      y_i = computeNewYPosition(y_i, vx_i, vy_i, theta_i, dt);
+      theta_i = computeNewThetaPosition(theta_i, vtheta_i, dt);
+    }
 
     // increment time
     time += dt;
   }  //  end for i < numsteps
 
-  traj.cost_ = pdist_scale_ * path_dist + occdist_scale_ * occ_dist;
+  traj.cost_ = config.pdist_scale * path_dist + config.occdist_scale * occ_dist;
+}
+
+const std::vector<TrajectoryLibrary::RelativePose>* TrajectoryPlanner::libraryRollout(
+    const TrajectoryPlannerConfig& config, double vx, double vtheta,
+    double* vx_samp, double* vtheta_samp, double acc_x, double acc_theta, double* sim_time) {
+  if (!trajectory_library_.IsInitialized() || !trajectory_library_.Matches(acc_x, acc_theta)) return NULL;
+
+  // same number of steps generateTrajectory takes, it doesn't change with sim time
+  double sim_granularity = *sim_time / config.sim_time * config.sim_granularity;
+  int num_steps = std::max(1, static_cast<int>(*sim_time / sim_granularity + 0.5));
+  uint64_t key = trajectory_library_.Snap(&vx, &vtheta, vx_samp, vtheta_samp, sim_time, num_steps);
+  if (key == TrajectoryLibrary::kInvalidKey) return NULL;
+  const std::vector<TrajectoryLibrary::RelativePose>* lattice = trajectory_library_.Find(key);
+  if (lattice) return lattice;
+
+  // integrate from the origin as generateTrajectory does, the robot doesn't move sideways
+  std::vector<TrajectoryLibrary::RelativePose> poses(num_steps);
+  double dt = *sim_time / num_steps;
+  double x_i = 0.0, y_i = 0.0, theta_i = 0.0;
+  double vx_i = vx, vtheta_i = vtheta;
+  for (int i = 0; i < num_steps; ++i) {
+    poses[i].x = x_i;
+    poses[i].y = y_i;
+    poses[i].theta = theta_i;
+    vx_i = computeNewVelocity(*vx_samp, vx_i, acc_x, dt);
+    vtheta_i = computeNewVelocity(*vtheta_samp, vtheta_i, acc_theta, dt);
+    x_i = computeNewXPosition(x_i, vx_i, 0.0, theta_i, dt);
+    y_i = computeNewYPosition(y_i, vx_i, 0.0, theta_i, dt);
+    theta_i = computeNewThetaPosition(theta_i, vtheta_i, dt);
+  }
+  return trajectory_library_.Insert(key, poses);
 }
 
 /**
  * create and score a trajectory given the current pose of the robot and selected velocities
  */
 void TrajectoryPlanner::generateTrajectoryWithoutCheckingFootprint(
+    const TrajectoryPlannerConfig& config,
     double x, double y, double theta,
     double vx, double vy, double vtheta,
     double vx_samp, double vy_samp, double vtheta_samp,
     double acc_x, double acc_y, double acc_theta,
     double impossible_cost,
     Trajectory& traj, double sim_time) {
-  // make sure the configuration doesn't change mid run
-  boost::mutex::scoped_lock l(configuration_mutex_);
-
   double x_i = x;
   double y_i = y;
   double theta_i = theta;
@@ -294,7 +343,7 @@ void TrajectoryPlanner::generateTrajectoryWithoutCheckingFootprint(
     return;
   }
 
-  double sim_granularity = sim_time / sim_time_ * sim_granularity_;
+  double sim_granularity = sim_time / config.sim_time * config.sim_granularity;
   // compute the number of steps we must take along this trajectory to be "safe"
   int num_steps = static_cast<int>(sim_time / sim_granularity + 0.5);
 
@@ -333,14 +382,7 @@ void TrajectoryPlanner::generateTrajectoryWithoutCheckingFootprint(
     }
 
     // update path and goal distances
-    double point_cost = 0x7ffffff;
-    for (auto it = global_plan_.begin(); it != global_plan_.end(); ++it) {
-      double loop_cost = hypot(x_i - it->pose.position.x, y_i - it->pose.position.y);
-      if (loop_cost < point_cost) {
-        point_cost = loop_cost;
-      }
-    }
-    path_dist += point_cost;
+    path_dist += pathDistance(x_i, y_i);
 
     // if a point on this trajectory has no clear path it is invalid
     if (impossible_cost <= path_dist) {
@@ -365,13 +407,14 @@ void TrajectoryPlanner::generateTrajectoryWithoutCheckingFootprint(
     time += dt;
   }
 
-  traj.cost_ = pdist_scale_ * path_dist;
+  traj.cost_ = config.pdist_scale * path_dist;
 }
 
 /**
  * create and score a trajectory given the current pose of the robot and selected velocities
  */
 void TrajectoryPlanner::generateTrajectoryForRecovery(
+    const TrajectoryPlannerConfig& config,
     double x, double y, double theta,
     double vx, double vy, double vtheta,
     double vx_samp, double vy_samp, double vtheta_samp,
@@ -379,9 +422,6 @@ void TrajectoryPlanner::generateTrajectoryForRecovery(
     double impossible_cost,
     Trajectory& traj, double sim_time, int within_obs_thresh) {
 
-  // make sure the configuration doesn't change mid run
-  boost::mutex::scoped_lock l(configuration_mutex_);
-
   double x_i = x;
   double y_i = y;
   double theta_i = theta;
@@ -399,7 +439,7 @@ void TrajectoryPlanner::generateTrajectoryForRecovery(
     return;
   }
 
-  double sim_granularity = sim_time / sim_time_ * sim_granularity_;
+  double sim_granularity = sim_time / config.sim_time * config.sim_granularity;
   // compute the number of steps we must take along this trajectory to be "safe"
   int num_steps = static_cast<int>(sim_time / sim_granularity + 0.5);
 
@@ -439,8 +479,9 @@ void TrajectoryPlanner::generateTrajectoryForRecovery(
 
     double footprint_cost = 0.0;
     if (i < num_calc_footprint_cost_) {
-      // check the point on the trajectory for legality
-      footprint_cost = footprintCost(x_i, y_i, theta_i);
+      // check the point on the trajectory for legality, recovery candidates
+      // start from the same pose and share the forward sweep
+      footprint_cost = sweepFootprintCost(x_i, y_i, theta_i);
 
       // if the footprint hits an obstacle this trajectory is invalid
       if (footprint_cost < 0) {
@@ -456,14 +497,7 @@ void TrajectoryPlanner::generateTrajectoryForRecovery(
     }
 
     // update path and goal distances
-    double point_cost = DBL_MAX;
-    for (auto it = global_plan_.begin(); it != global_plan_.end(); ++it) {
-      double loop_cost = hypot(x_i - it->pose.position.x, y_i - it->pose.position.y);
-      if (loop_cost < point_cost) {
-        point_cost = loop_cost;
-      }
-    }
-    path_dist += point_cost;
+    path_dist += pathDistance(x_i, y_i);
 
     // if a point on this trajectory has no clear path it is invalid
     if (impossible_cost <= path_dist) {
@@ -488,7 +522,7 @@ void TrajectoryPlanner::generateTrajectoryForRecovery(
     time += dt;
   }  // end for i < numsteps
 
-  traj.cost_ = pdist_scale_ * path_dist;
+  traj.cost_ = config.pdist_scale * path_dist;
 }
 
 void TrajectoryPlanner::UpdateGoalAndPlan(const geometry_msgs::PoseStamped& goal, const std::vector<geometry_msgs::PoseStamped>& new_plan) {
@@ -500,10 +534,18 @@ void TrajectoryPlanner::UpdateGoalAndPlan(const geometry_msgs::PoseStamped& goal
   final_goal_x_ = goal.pose.position.x;
   final_goal_y_ = goal.pose.position.y;
 
+  // queries fall back to walking global_plan_ if it isn't a part of the grid's path
+  path_grid_.SetPlanRange(global_plan_);
+
   // set need_backward_ to false every time
   need_backward_ = false;
 }
 
+void TrajectoryPlanner::UpdatePathGrid(const std::vector<geometry_msgs::PoseStamped>& path) {
+  // 2m around the path covers the rollouts in most cases
+  path_grid_.Build(path, 0.1, 2.0);
+}
+
 bool TrajectoryPlanner::checkTrajectory(double x, double y, double theta, double vx, double vy,
                                         double vtheta, double vx_samp, double vy_samp, double vtheta_samp) {
   Trajectory t;
@@ -526,7 +568,7 @@ bool TrajectoryPlanner::CheckTrajectoryWithSimTime(double x, double y, double th
   Trajectory t;
 
   double impossible_cost = costmap_.getSizeInCellsX() * costmap_.getSizeInCellsY();
-  generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
+  generateTrajectory(config_, x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
                      acc_lim_x_, acc_lim_y_, acc_lim_theta_, impossible_cost, t, sim_time);
 
   // if the trajectory is a legal one... the check passes
@@ -540,15 +582,78 @@ bool TrajectoryPlanner::CheckTrajectoryWithSimTime(double x, double y, double th
   return false;
 }
 
+bool TrajectoryPlanner::checkRotationSweep(double x, double y, double theta, double angle) {
+  double resolution = costmap_.getResolution();
+  double step = 0.5 * resolution / std::max(circumscribed_radius_, resolution);
+  double dir = angle < 0.0 ? -1.0 : 1.0;
+  int num_steps = static_cast<int>(ceil(fabs(angle) / step));
+  for (int i = 0; i <= num_steps; ++i) {
+    double theta_i = theta + dir * std::min(i * step, fabs(angle));
+    if (footprintCost(x, y, theta_i) < 0) {
+      GAUSSIAN_WARN("[TRAJECTORY PLANNER] rotation sweep hits obstacle at %lf of %lf", dir * i * step, angle);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TrajectoryPlanner::checkInPlaceRotation(double x, double y, double theta, double vtheta, double angle_to_goal) {
+  // we may overshoot the goal heading if we can't brake in time
+  double braking_arc = acc_lim_theta_ > 0.0 ? vtheta * vtheta / (2.0 * acc_lim_theta_) : 0.0;
+  double arc = std::min(std::max(fabs(angle_to_goal), braking_arc), 2.0 * M_PI);
+  return checkRotationSweep(x, y, theta, vtheta < 0.0 ? -arc : arc);
+}
+
+bool TrajectoryPlanner::checkStopping(double x, double y, double theta, double vx, double vy) {
+  double v = hypot(vx, vy);
+  double braking_dis = acc_lim_x_ > 0.0 ? v * v / (2.0 * acc_lim_x_) : 0.0;
+  double heading = theta + atan2(vy, vx);
+  double step = 0.5 * costmap_.getResolution();
+  int num_steps = static_cast<int>(ceil(braking_dis / step));
+  for (int i = 0; i <= num_steps; ++i) {
+    double dis = std::min(i * step, braking_dis);
+    if (footprintCost(x + dis * cos(heading), y + dis * sin(heading), theta) < 0) {
+      GAUSSIAN_WARN("[TRAJECTORY PLANNER] stopping from %lf hits obstacle at %lf", v, dis);
+      return false;
+    }
+  }
+  return true;
+}
+
+void TrajectoryPlanner::updateClearance(double x, double y, double theta) {
+  clearance_x_ = x;
+  clearance_y_ = y;
+  clearance_theta_ = theta;
+  bool blocked = sweepFootprintCost(x, y, theta) < 0;
+  front_clearance_.dis = rear_clearance_.dis = 0.0;
+  front_clearance_.blocked = rear_clearance_.blocked = blocked;
+}
+
+double TrajectoryPlanner::sweepClearance(double direction, double max_dis, Clearance* clearance) {
+  // extend the corridor from where the last query stopped, half a cell per footprint
+  double step = 0.5 * costmap_.getResolution();
+  double cos_th = direction * cos(clearance_theta_);
+  double sin_th = direction * sin(clearance_theta_);
+  while (!clearance->blocked && clearance->dis < max_dis) {
+    double dis = std::min(clearance->dis + step, max_dis);
+    if (sweepFootprintCost(clearance_x_ + dis * cos_th, clearance_y_ + dis * sin_th, clearance_theta_) < 0) {
+      clearance->blocked = true;
+    } else {
+      clearance->dis = dis;
+    }
+  }
+  return std::min(clearance->dis, max_dis);
+}
+
 double TrajectoryPlanner::scoreTrajectory(double x, double y, double theta, double vx, double vy,
                                           double vtheta, double vx_samp, double vy_samp, double vtheta_samp) {
   Trajectory t;
   double impossible_cost = costmap_.getSizeInCellsX() * costmap_.getSizeInCellsY();
-  generateTrajectory(x, y, theta,
+  generateTrajectory(config_, x, y, theta,
                      vx, vy, vtheta,
                      vx_samp, vy_samp, vtheta_samp,
                      acc_lim_x_, acc_lim_y_, acc_lim_theta_,
-                     impossible_cost, t, sim_time_);
+                     impossible_cost, t, config_.sim_time);
 
   // return the cost.
   return static_cast<double>(t.cost_);
@@ -558,25 +663,39 @@ double TrajectoryPlanner::scoreTrajectory(double x, double y, double theta, doub
  * check front safe
  */
 bool TrajectoryPlanner::checkFrontSafe(
+    const TrajectoryPlannerConfig& config,
     double x, double y, double theta,
     double vx, double vy, double vtheta) {
 
-  // make sure the configuration doesn't change mid run
-  boost::mutex::scoped_lock l(configuration_mutex_);
+  // straight motion is answered by the clearance corridor of this cycle, swept in
+  // half-cell steps, i.e. at least as densely as the rollout below
+  double safe_dis = fabs(vx) * config.front_safe_sim_time;
+  if (front_sweep_active_ && vy == 0.0 && vtheta == 0.0 &&
+      config.front_safe_sim_granularity * fabs(vx) >= 0.5 * costmap_.getResolution()) {
+    double direction = vx < 0.0 ? -1.0 : 1.0;
+    unsigned int cell_x, cell_y;
+    if (!costmap_.worldToMap(x, y, cell_x, cell_y) ||
+        !costmap_.worldToMap(x + direction * safe_dis * cos(theta), y + direction * safe_dis * sin(theta),
+                             cell_x, cell_y)) {
+      return false;
+    }
+    if (sweepFootprintCost(x, y, theta) < 0) return false;
+    return (vx < 0.0 ? rearClearance(safe_dis) : frontClearance(safe_dis)) >= safe_dis;
+  }
 
   double x_i = x;
   double y_i = y;
   double theta_i = theta;
 
   // compute the number of steps
-  int num_steps = static_cast<int>(front_safe_sim_time_ / front_safe_sim_granularity_ + 0.5);
+  int num_steps = static_cast<int>(config.front_safe_sim_time / config.front_safe_sim_granularity + 0.5);
 
   // we at least want to take one step... even if we won't move, we want to score our current position
   if (num_steps == 0) {
     num_steps = 1;
   }
 
-  double dt = front_safe_sim_time_ / num_steps;
+  double dt = config.front_safe_sim_time / num_steps;
   double time = 0.0;
 
   for (int i = 0; i < num_steps; ++i) {
@@ -589,7 +708,7 @@ bool TrajectoryPlanner::checkFrontSafe(
     }
 
     // check the point on the trajectory for legality
-    double footprint_cost = footprintCost(x_i, y_i, theta_i);
+    double footprint_cost = sweepFootprintCost(x_i, y_i, theta_i);
 
     // if the footprint hits an obstacle this trajectory is invalid
     if (footprint_cost < 0) {
@@ -613,8 +732,6 @@ void TrajectoryPlanner::SetNeedBackward(double x, double y, double theta,
                                         double vx_samp, double vy_samp, double vtheta_samp,
                                         double acc_x, double acc_y, double acc_theta,
                                         double impossible_cost, double sim_time) {
-  // make sure the configuration doesn't change mid run
-  // boost::mutex::scoped_lock l(configuration_mutex_);
 
   double x_i = x;
   double y_i = y;
@@ -624,7 +741,7 @@ void TrajectoryPlanner::SetNeedBackward(double x, double y, double theta,
   double vy_i = vy;
   double vtheta_i = vtheta;
 
-  double sim_granularity = sim_time / sim_time_ * sim_granularity_;
+  double sim_granularity = sim_time / config_.sim_time * config_.sim_granularity;
   // compute the number of steps we must take along this trajectory to be "safe"
   int num_steps = static_cast<int>(sim_time / sim_granularity + 0.5);
   // we at least want to take one step... even if we won't move, we want to score our current position
@@ -646,10 +763,10 @@ void TrajectoryPlanner::SetNeedBackward(double x, double y, double theta,
     if (!costmap_.worldToMap(x_i, y_i, cell_x, cell_y)) break;
 
     // if the footprint hits an obstacle this trajectory is invalid
-    if (footprintCost(x_i, y_i, theta_i) < 0) {
+    if (sweepFootprintCost(x_i, y_i, theta_i) < 0) {
       Trajectory traj;
-      generateTrajectoryForRecovery(x, y, theta, vx, vy, vtheta, -0.1, 0.0, 0.0,
-                                    acc_x, acc_y, acc_theta, impossible_cost, traj, sim_time_, 5);
+      generateTrajectoryForRecovery(config_, x, y, theta, vx, vy, vtheta, -0.1, 0.0, 0.0,
+                                    acc_x, acc_y, acc_theta, impossible_cost, traj, config_.sim_time, 5);
       if (traj.cost_ < 0) {
         need_backward_ = false;
       } else {
@@ -683,15 +800,102 @@ void TrajectoryPlanner::SetNeedBackward(double x, double y, double theta,
   need_backward_ = false;
 }
 
+/**
+ * dynamic window admissibility, only rejects samples that generateTrajectory
+ * would reject anyway, but with a single footprint query instead of a rollout
+ */
+bool TrajectoryPlanner::isSampleAdmissible(const TrajectoryPlannerConfig& config,
+                                           double x, double y, double theta,
+                                           double vx, double vy, double vtheta,
+                                           double vx_samp, double vy_samp, double vtheta_samp,
+                                           double acc_x, double acc_y, double acc_theta,
+                                           double sim_time) {
+  // trajectory that is circle will be discarded
+  if (fabs(vtheta_samp) > 0.00001 && sim_time > M_PI / fabs(vtheta_samp)) {
+    return false;
+  }
+
+  // same discretization as generateTrajectory, so the queried pose is one of its poses
+  double sim_granularity = sim_time / config.sim_time * config.sim_granularity;
+  int num_steps = static_cast<int>(sim_time / sim_granularity + 0.5);
+  if (num_steps == 0) num_steps = 1;
+  double dt = sim_time / num_steps;
+
+  // only poses whose footprint is checked in rollout can prove a sample infeasible
+  int check_steps = std::min(num_steps, num_calc_footprint_cost_);
+  if (check_steps <= 0) return true;
+
+  // distance needed to brake from vx_samp to zero
+  double braking_dis = acc_x > 0.0 ? vx_samp * vx_samp / (2.0 * acc_x) : 0.0;
+
+  double x_i = x;
+  double y_i = y;
+  double theta_i = theta;
+  double vx_i = vx;
+  double vy_i = vy;
+  double vtheta_i = vtheta;
+  double dis_accu = 0.0;
+
+  for (int i = 0; i < check_steps; ++i) {
+    if (dis_accu >= braking_dis || i == check_steps - 1) {
+      unsigned int cell_x, cell_y;
+      if (!costmap_.worldToMap(x_i, y_i, cell_x, cell_y)) return false;
+      if (vtheta_samp == 0.0) return sweepFootprintCost(x_i, y_i, theta_i) >= 0;
+      return footprintCost(x_i, y_i, theta_i) >= 0;
+    }
+
+    vx_i = computeNewVelocity(vx_samp, vx_i, acc_x, dt);
+    vy_i = computeNewVelocity(vy_samp, vy_i, acc_y, dt);
+    vtheta_i = computeNewVelocity(vtheta_samp, vtheta_i, acc_theta, dt);
+
+    double new_x_i = computeNewXPosition(x_i, vx_i, vy_i, theta_i, dt);
+    double new_y_i = computeNewYPosition(y_i, vx_i, vy_i, theta_i, dt);
+    dis_accu += hypot(new_x_i - x_i, new_y_i - y_i);
+    x_i = new_x_i;
+    y_i = new_y_i;
+    theta_i = computeNewThetaPosition(theta_i, vtheta_i, dt);
+  }
+
+  return true;
+}
+
+void TrajectoryPlanner::sampleVtheta(const TrajectoryPlannerConfig& config,
+                                     double x, double y, double theta,
+                                     double vx, double vy, double vtheta,
+                                     double vx_samp, double vtheta_samp,
+                                     double acc_x, double acc_y, double acc_theta,
+                                     double impossible_cost, double sim_time, double* cost_bound,
+                                     Trajectory* traj, std::vector<Trajectory>* all_explored) {
+  ++samples_considered_;
+  const std::vector<TrajectoryLibrary::RelativePose>* lattice =
+      libraryRollout(config, vx, vtheta, &vx_samp, &vtheta_samp, acc_x, acc_theta, &sim_time);
+  if (!isSampleAdmissible(config, x, y, theta, vx, vy, vtheta, vx_samp, 0.0, vtheta_samp,
+                          acc_x, acc_y, acc_theta, sim_time)) {
+    ++samples_pruned_;
+    traj->cost_ = -1.0;
+    return;
+  }
+  generateTrajectory(config, x, y, theta, vx, vy, vtheta, vx_samp, 0.0, vtheta_samp,
+                     acc_x, acc_y, acc_theta, impossible_cost, *traj, sim_time, *cost_bound, lattice);
+  ++samples_rolled_out_;
+  if (traj->cost_ == -3.0) {
+    ++samples_bounded_;
+    return;
+  }
+  all_explored->push_back(*traj);
+  if (traj->cost_ >= 0 && traj->cost_ < *cost_bound) *cost_bound = traj->cost_;
+}
+
 /*
  * create the trajectories we wish to score
  */
-Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double theta,
+Trajectory TrajectoryPlanner::createTrajectories(const TrajectoryPlannerConfig& config,
+                                                 double x, double y, double theta,
                                                  double max_vel, double highlight, double current_point_dis,
                                                  double vx, double vy, double vtheta,
                                                  double acc_x, double acc_y, double acc_theta, std::vector<Trajectory>* all_explored) {
   // compute feasible velocity limits in robot space
-  double max_vel_x = max_vel_x_, max_vel_theta;
+  double max_vel_x = config.max_vel_x, max_vel_theta;
   double min_vel_x, min_vel_theta;
 
   double final_goal_dist = hypot(final_goal_x_ - x, final_goal_y_ - y);
@@ -699,13 +903,13 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
   if (final_goal_dist < final_goal_dis_th_) {
     final_vel_ratio = final_vel_ratio_;
   }
-  max_vel_x = std::min(max_vel_x, final_goal_dist / sim_time_ * final_vel_ratio);
+  max_vel_x = std::min(max_vel_x, final_goal_dist / config.sim_time * final_vel_ratio);
 
-  max_vel_x = std::max(std::min(max_vel_x, vx + acc_x * sim_time_), min_vel_x_);
-  min_vel_x = std::max(min_vel_x_, vx - acc_x * sim_time_);
+  max_vel_x = std::max(std::min(max_vel_x, vx + acc_x * config.sim_time), min_vel_x_);
+  min_vel_x = std::max(min_vel_x_, vx - acc_x * config.sim_time);
 
-  max_vel_theta = std::min(max_vel_th_, vtheta + acc_theta * sim_time_);
-  min_vel_theta = std::max(min_vel_th_, vtheta - acc_theta * sim_time_);
+  max_vel_theta = std::min(config.max_vel_th, vtheta + acc_theta * config.sim_time);
+  min_vel_theta = std::max(min_vel_th_, vtheta - acc_theta * config.sim_time);
 
   // we want to sample the velocity space regularly
   double dvtheta = (max_vel_theta - min_vel_theta) / (vtheta_samples_ - 1);
@@ -726,8 +930,9 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
   Trajectory* swap = NULL;
 
   // check front safe first, if not safe, return best->cost_ = -1
-  if (!checkFrontSafe(x, y, theta, vx, vy, vtheta)) {
+  if (!checkFrontSafe(config, x, y, theta, vx, vy, vtheta)) {
     GAUSSIAN_ERROR("[LOCAL PLANNER] checkFrontSafe failed! vx: %lf, vtheta: %lf", vx, vtheta);
+    last_best_valid_ = false;
     best_traj->is_footprint_safe_ = false;
     return *best_traj;
   }
@@ -739,7 +944,7 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
   vx_samp = max_vel;
   if (vx_samp > max_vel_x) vx_samp = max_vel_x;
   if (vx_samp < min_vel_x_) vx_samp = min_vel_x_;
-  double temp_sim_time = sim_time_;
+  double temp_sim_time = config.sim_time;
   temp_sim_time = highlight * 0.8 / vx_samp;
   // velocity goes higher if current_point_dis is too far
   if (current_point_dis > 0.12) {
@@ -749,34 +954,102 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
   if (temp_sim_time < 2.0) temp_sim_time = 2.0;
 
   vtheta_samp = 0;
-  // first sample the straight trajectory
-  generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
-                     acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, temp_sim_time);
-  all_explored->push_back(*comp_traj);
-
-  // if the new trajectory is better... let's take it
-  if (comp_traj->cost_ >= 0 && (comp_traj->cost_ < best_traj->cost_ || best_traj->cost_ < 0)) {
-    swap = best_traj;
-    best_traj = comp_traj;
-    comp_traj = swap;
+  // first sample the straight trajectory, with the library on this snaps vx_samp and
+  // sim time for every sample of the cycle
+  ++samples_considered_;
+  const std::vector<TrajectoryLibrary::RelativePose>* lattice =
+      libraryRollout(config, vx, vtheta, &vx_samp, &vtheta_samp, acc_x, acc_theta, &temp_sim_time);
+  if (isSampleAdmissible(config, x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
+                         acc_x, acc_y, acc_theta, temp_sim_time)) {
+    generateTrajectory(config, x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
+                       acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, temp_sim_time, DBL_MAX, lattice);
+    ++samples_rolled_out_;
+    all_explored->push_back(*comp_traj);
+
+    // if the new trajectory is better... let's take it
+    if (comp_traj->cost_ >= 0 && (comp_traj->cost_ < best_traj->cost_ || best_traj->cost_ < 0)) {
+      swap = best_traj;
+      best_traj = comp_traj;
+      comp_traj = swap;
+    }
+  } else {
+    ++samples_pruned_;
   }
 
-    vtheta_samp = min_vel_theta;
-    // next sample all theta trajectories
+    // next sample all theta trajectories on the uniform grid, last best command
+    // and coarse samples first, then refine around the best sample
+    int num_samples = vtheta_samples_ - 1;
+    int coarse_step = std::max(1, std::min(coarse_vtheta_step_, num_samples));
+    std::vector<Trajectory> samples(num_samples > 0 ? num_samples : 0);
+    std::vector<bool> sampled(samples.size(), false);
+
+    // best cost so far, samples that can't beat it stop rolling out early
+    double cost_bound = best_traj->cost_ >= 0 ? best_traj->cost_ : DBL_MAX;
+
+    // warm start with last best command and its neighbours to get a tight bound
+    int seed = -1;
+    if (last_best_valid_ && num_samples > 0 && dvtheta > 0.0) {
+      seed = static_cast<int>(floor((last_best_vtheta_ - min_vel_theta) / dvtheta + 0.5));
+      seed = std::max(0, std::min(num_samples - 1, seed));
+      for (int j = std::max(0, seed - 1); j <= std::min(num_samples - 1, seed + 1); ++j) {
+        sampleVtheta(config, x, y, theta, vx, vy, vtheta, vx_samp, min_vel_theta + j * dvtheta,
+                     acc_x, acc_y, acc_theta, impossible_cost, temp_sim_time, &cost_bound, &samples[j], all_explored);
+        sampled[j] = true;
+      }
+    }
+
+    for (int j = 0; j < num_samples; j += coarse_step) {
+      if (sampled[j]) continue;
+      sampleVtheta(config, x, y, theta, vx, vy, vtheta, vx_samp, min_vel_theta + j * dvtheta,
+                   acc_x, acc_y, acc_theta, impossible_cost, temp_sim_time, &cost_bound, &samples[j], all_explored);
+      sampled[j] = true;
+    }
+
+    int best_sampled = -1;
+    for (int j = 0; j < num_samples; ++j) {
+      if (sampled[j] && samples[j].cost_ >= 0 &&
+          (best_sampled < 0 || samples[j].cost_ < samples[best_sampled].cost_)) {
+        best_sampled = j;
+      }
+    }
+
+    // refine between the neighbours of best sample. If the straight one bounded
+    // every sample, refine around the straight and warm start commands instead,
+    // a sample between coarse ones may still beat the bound. Fall back to the
+    // full uniform set if nothing is valid at all
+    std::vector<int> refine_centers;
+    if (best_sampled >= 0) {
+      refine_centers.push_back(best_sampled);
+    } else if (cost_bound < DBL_MAX) {
+      if (dvtheta > 0.0) {
+        int straight = static_cast<int>(floor(-min_vel_theta / dvtheta + 0.5));
+        refine_centers.push_back(std::max(0, std::min(num_samples - 1, straight)));
+      }
+      if (seed >= 0) refine_centers.push_back(seed);
+    }
+    std::vector<std::pair<int, int> > refine_ranges;
+    for (unsigned int c = 0; c < refine_centers.size(); ++c) {
+      refine_ranges.push_back(std::make_pair(std::max(0, refine_centers[c] - coarse_step + 1),
+                                             std::min(num_samples - 1, refine_centers[c] + coarse_step - 1)));
+    }
+    if (best_sampled < 0 && cost_bound == DBL_MAX) {
+      refine_ranges.push_back(std::make_pair(0, num_samples - 1));
+    }
+    for (unsigned int r = 0; r < refine_ranges.size(); ++r) {
+      for (int j = refine_ranges[r].first; j <= refine_ranges[r].second; ++j) {
+        if (sampled[j]) continue;
+        sampleVtheta(config, x, y, theta, vx, vy, vtheta, vx_samp, min_vel_theta + j * dvtheta,
+                     acc_x, acc_y, acc_theta, impossible_cost, temp_sim_time, &cost_bound, &samples[j], all_explored);
+        sampled[j] = true;
+      }
+    }
+
     // calculate average theta if lots of best_traj->thetav_ is equal
     double average_count = 0;
     double average_theta = 0;
-    std::vector<double> costs{};
-    std::vector<double> costs_without_footprint{};
-    for(int j = 0; j < vtheta_samples_ - 1; ++j){
-      generateTrajectory(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
-          acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, temp_sim_time);
-      all_explored->push_back(*comp_traj);
-      costs.push_back(comp_traj->cost_);
-      Trajectory tmp_traj;
-      generateTrajectoryWithoutCheckingFootprint(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
-          acc_x, acc_y, acc_theta, impossible_cost, tmp_traj, temp_sim_time);
-      costs_without_footprint.push_back(tmp_traj.cost_);
+    for (int j = 0; j < num_samples; ++j) {
+      if (!sampled[j] || samples[j].cost_ < 0) continue;
+      *comp_traj = samples[j];
 
       //if the new trajectory is better... let's take it
       if (comp_traj->cost_ >= 0 && (comp_traj->cost_ <= best_traj->cost_ || best_traj->cost_ < 0)) {
@@ -791,8 +1064,6 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
         best_traj = comp_traj;
         comp_traj = swap;
       }
-
-      vtheta_samp += dvtheta;
     }
     if (average_count) {
       best_traj->thetav_ = average_theta / average_count;
@@ -800,17 +1071,21 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
 
   // if best_traj is valid, just return, as we don't want to rotate in place
   if (best_traj->cost_ >= 0.0) {
+    last_best_vtheta_ = best_traj->thetav_;
+    last_best_valid_ = true;
     return *best_traj;
   }
+  last_best_valid_ = false;
 
-  // next we want to generate trajectories for rotating in place
+  // next we want to generate trajectories for rotating in place, they start from
+  // the same pose as the samples, so footprints come from the sweep cache
   vtheta_samp = std::max(min_vel_theta, -1 * min_in_place_vel_th_);
   vx_samp = 0.0;
   vy_samp = 0.0;
 
   // rotate to right
-  generateTrajectoryForRecovery(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
-                                acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, sim_time_, 5);
+  generateTrajectoryForRecovery(config, x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
+                                acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, config.sim_time, 5);
   if (comp_traj->cost_ >= 0.0) {
     GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] rotate to right");
     swap = best_traj;
@@ -821,8 +1096,8 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
 
   // rotate to left
   vtheta_samp = std::min(max_vel_theta, min_in_place_vel_th_);
-  generateTrajectoryForRecovery(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
-                                acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, sim_time_, 5);
+  generateTrajectoryForRecovery(config, x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
+                                acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, config.sim_time, 5);
   if (comp_traj->cost_ >= 0.0) {
     GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] rotate to left");
     swap = best_traj;
@@ -836,8 +1111,8 @@ Trajectory TrajectoryPlanner::createTrajectories(double x, double y, double thet
   vtheta_samp = 0.0;
   vx_samp = backup_vel_;
   vy_samp = 0.0;
-  generateTrajectoryForRecovery(x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
-                                acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, sim_time_, 5);
+  generateTrajectoryForRecovery(config, x, y, theta, vx, vy, vtheta, vx_samp, vy_samp, vtheta_samp,
+                                acc_x, acc_y, acc_theta, impossible_cost, *comp_traj, config.sim_time, 5);
 
   // our last chance
   swap = best_traj;
@@ -858,11 +1133,24 @@ Trajectory TrajectoryPlanner::findBestPath(tf::Stamped<tf::Pose> global_pose, do
   // std::vector<fixpattern_local_planner::Position2DInt> footprint_list =
   //     footprint_helper_.getFootprintCells(pos, footprint_spec_, costmap_, true);
 
+  // footprint results of the forward sweep are only valid within one cycle
+  front_sweep_cache_.clear();
+  front_sweep_active_ = true;
+  updateClearance(pos[0], pos[1], pos[2]);
+
+  samples_considered_ = 0;
+  samples_pruned_ = 0;
+  samples_rolled_out_ = 0;
+  samples_bounded_ = 0;
+  footprint_checks_ = 0;
+  sweep_hits_ = 0;
+
   // rollout trajectories and find the minimum cost one
-  Trajectory best = createTrajectories(pos[0], pos[1], pos[2],
+  Trajectory best = createTrajectories(config_, pos[0], pos[1], pos[2],
                                        traj_vel, highlight, current_point_dis,
                                        vel[0], vel[1], vel[2],
                                        acc_lim_x_, acc_lim_y_, acc_lim_theta_, all_explored);
+  front_sweep_active_ = false;
   ROS_DEBUG("Trajectories created");
 
   if (best.cost_ < 0) {
@@ -878,12 +1166,46 @@ Trajectory TrajectoryPlanner::findBestPath(tf::Stamped<tf::Pose> global_pose, do
   return best;
 }
 
+double TrajectoryPlanner::pathDistance(double x, double y) {
+  double dist;
+  if (path_grid_.PathDistance(x, y, &dist)) return dist;
+
+  // out of grid, walk through the plan
+  dist = DBL_MAX;
+  for (auto it = global_plan_.begin(); it != global_plan_.end(); ++it) {
+    double loop_cost = hypot(x - it->pose.position.x, y - it->pose.position.y);
+    if (loop_cost < dist) {
+      dist = loop_cost;
+    }
+  }
+  return dist;
+}
+
 // we need to take the footprint of the robot into account when we calculate cost to obstacles
 double TrajectoryPlanner::footprintCost(double x_i, double y_i, double theta_i) {
   // check if the footprint is legal
+  ++footprint_checks_;
+  if (footprint_stamps_.IsInitialized()) return footprint_stamps_.FootprintCost(costmap_, x_i, y_i, theta_i);
   return world_model_.footprintCost(x_i, y_i, theta_i, footprint_spec_, inscribed_radius_, circumscribed_radius_);
 }
 
+// only the very same pose shares a result, a collision check is never approximated
+double TrajectoryPlanner::sweepFootprintCost(double x_i, double y_i, double theta_i) {
+  // out of findBestPath costmap may have changed since the sweep
+  if (!front_sweep_active_) return footprintCost(x_i, y_i, theta_i);
+
+  SweepPose pose = {x_i, y_i, theta_i};
+  auto it = front_sweep_cache_.find(pose);
+  if (it != front_sweep_cache_.end()) {
+    ++sweep_hits_;
+    return it->second;
+  }
+
+  double cost = footprintCost(x_i, y_i, theta_i);
+  front_sweep_cache_[pose] = cost;
+  return cost;
+}
+
 };  // namespace fixpattern_local_planner
 
 
@@ -28,7 +28,9 @@ namespace fixpattern_local_planner {
 
 
 FixPatternTrajectoryPlannerROS::FixPatternTrajectoryPlannerROS()
-  : world_model_(NULL), tc_(NULL), la_(NULL), costmap_ros_(NULL), tf_(NULL), initialized_(false), odom_helper_("odom") {
+  : world_model_(NULL), tc_(NULL), la_(NULL), costmap_ros_(NULL), tf_(NULL),
+    plan_offset_(0), plan_extension_(0), costmap_revision_(0), clearance_revision_(0), clearance_index_(0),
+    clearance_vel_(-1.0), initialized_(false), odom_helper_("odom") {
   rotate_to_goal_k_ = 0.9;
   last_rotate_to_goal_dir_ = 0;
   last_target_yaw_ = 0.0;
@@ -37,7 +39,9 @@ FixPatternTrajectoryPlannerROS::FixPatternTrajectoryPlannerROS()
 }
 
 FixPatternTrajectoryPlannerROS::FixPatternTrajectoryPlannerROS(std::string name, tf::TransformListener* tf, costmap_2d::Costmap2DROS* costmap_ros)
-  : world_model_(NULL), tc_(NULL), la_(NULL), costmap_ros_(NULL), tf_(NULL), initialized_(false), odom_helper_("odom") {
+  : world_model_(NULL), tc_(NULL), la_(NULL), costmap_ros_(NULL), tf_(NULL),
+    plan_offset_(0), plan_extension_(0), costmap_revision_(0), clearance_revision_(0), clearance_index_(0),
+    clearance_vel_(-1.0), initialized_(false), odom_helper_("odom") {
   // initialize the planner
   initialize(name, tf, costmap_ros);
 }
@@ -57,7 +61,7 @@ void FixPatternTrajectoryPlannerROS::initialize(std::string name, tf::TransformL
     trans_stopped_velocity_ = 1e-2;
     int num_calc_footprint_cost;
     double sim_time, sim_granularity, front_safe_sim_time, front_safe_sim_granularity;
-    int vtheta_samples;
+    int vtheta_samples, coarse_vtheta_step;
     double pdist_scale, gdist_scale, occdist_scale;
     double max_vel_x, min_vel_x;
     double backup_vel;
@@ -124,6 +128,7 @@ void FixPatternTrajectoryPlannerROS::initialize(std::string name, tf::TransformL
     private_nh.param("p20", front_safe_sim_time, 1.0);
     private_nh.param("p21", front_safe_sim_granularity, 1.0);
     private_nh.param("p25", vtheta_samples, 20);
+    private_nh.param("coarse_vtheta_step", coarse_vtheta_step, 1);
 
     private_nh.param("p22", pdist_scale, 0.6);
     private_nh.param("p23", gdist_scale, 0.8);
@@ -167,12 +172,54 @@ void FixPatternTrajectoryPlannerROS::initialize(std::string name, tf::TransformL
                                 vtheta_samples,
                                 pdist_scale, gdist_scale, occdist_scale, 
                                 max_vel_x, min_vel_x, max_vel_theta_, min_vel_theta_, min_in_place_rotational_vel_,
-                                backup_vel, min_hightlight_dis_, final_vel_ratio_, final_goal_dis_th_);
+                                backup_vel, min_hightlight_dis_, final_vel_ratio_, final_goal_dis_th_,
+                                coarse_vtheta_step);
+
+    bool use_footprint_stamps;
+    std::string footprint_stamp_file;
+    private_nh.param("use_footprint_stamps", use_footprint_stamps, false);
+    private_nh.param("footprint_stamp_file", footprint_stamp_file, std::string(""));
+    if (use_footprint_stamps) {
+      GAUSSIAN_WARN("[FIXPATTERN LOCAL PLANNER] footprint stamps check a band about three cells wide around "
+                    "the footprint, trajectories pass less close to obstacles than with rasterization");
+      tc_->initFootprintStamps(footprint_stamp_file);
+    }
+
+    bool use_trajectory_library;
+    std::string trajectory_library_file;
+    double library_vel_step, library_vtheta_step, library_time_step;
+    int library_max_entries;
+    private_nh.param("use_trajectory_library", use_trajectory_library, false);
+    private_nh.param("trajectory_library_file", trajectory_library_file, std::string(""));
+    private_nh.param("trajectory_library_vel_step", library_vel_step, 0.02);
+    private_nh.param("trajectory_library_vtheta_step", library_vtheta_step, 0.02);
+    private_nh.param("trajectory_library_time_step", library_time_step, 0.1);
+    private_nh.param("trajectory_library_max_entries", library_max_entries, 20000);
+    if (use_trajectory_library) {
+      tc_->initTrajectoryLibrary(library_vel_step, library_vtheta_step, library_time_step,
+                                 std::max(0, library_max_entries), trajectory_library_file);
+    }
+
+    private_nh.param("planner_stats_file", planner_stats_file_, std::string(""));
+    if (!planner_stats_file_.empty()) {
+      planner_stats_stream_.open(planner_stats_file_.c_str(), std::ios::out | std::ios::trunc);
+      if (planner_stats_stream_.is_open()) {
+        planner_stats_stream_ << "stamp,planner,latency,considered,pruned,rollouts,bounded,footprint_checks,sweep_hits" << '\n';
+      } else {
+        GAUSSIAN_WARN("[FIXPATTERN LOCAL PLANNER] failed to open planner_stats_file: %s", planner_stats_file_.c_str());
+      }
+    }
+
+    double odom_filter_alpha;
+    private_nh.param("odom_filter_alpha", odom_filter_alpha, 0.5);
+    odom_helper_.setVelocityFilter(odom_filter_alpha);
 
     la_ = new LookAheadPlanner(*world_model_, *costmap_, footprint_spec_,
                                sim_granularity, acc_lim_x_, acc_lim_y_, acc_lim_theta_,
                                max_vel_x, min_vel_x, max_vel_theta_, min_vel_theta_, min_in_place_rotational_vel_);
 
+    profile_limits_.SetLimits(max_vel_x, min_vel_x, max_vel_theta_, acc_lim_x_);
+
     initialized_ = true;
 
   } else {
@@ -180,6 +227,20 @@ void FixPatternTrajectoryPlannerROS::initialize(std::string name, tf::TransformL
   }
 }
 
+void FixPatternTrajectoryPlannerROS::recordPlannerStats(PlannerType planner_type, double latency) {
+  PlannerCycleStats stats = {0, 0, 0, 0, 0, 0};
+  if (planner_type == TRAJECTORY_PLANNER) stats = tc_->getCycleStats();
+
+  ROS_DEBUG("[FIXPATTERN LOCAL PLANNER] planner latency: %lf, samples pruned: %d / %d, rollouts: %d, bounded: %d, "
+            "footprint checks: %d, sweep hits: %d", latency, stats.samples_pruned, stats.samples_considered,
+            stats.rollouts, stats.bounded, stats.footprint_checks, stats.sweep_hits);
+
+  if (!planner_stats_stream_.is_open()) return;
+  planner_stats_stream_ << std::fixed << ros::Time::now().toSec() << "," << planner_type << "," << latency << ","
+                        << stats.samples_considered << "," << stats.samples_pruned << "," << stats.rollouts << ","
+                        << stats.bounded << "," << stats.footprint_checks << "," << stats.sweep_hits << '\n';
+}
+
 FixPatternTrajectoryPlannerROS::~FixPatternTrajectoryPlannerROS() {
   // make sure to clean things up
 //  delete dsrv_;
@@ -203,12 +264,13 @@ bool FixPatternTrajectoryPlannerROS::stopWithAccLimits(PlannerType planner_type,
   double vel_yaw = tf::getYaw(robot_vel.getRotation());
   double vth = sign(vel_yaw) * std::max(0.0, (fabs(vel_yaw) - acc_lim_theta_ * sim_period_));
 
-  // we do want to check whether or not the command is valid
+  // we do want to check whether or not the command is valid, braking is straight
+  // with constant deceleration, so only the segment we cover while stopping is checked
   double yaw = tf::getYaw(global_pose.getRotation());
   bool valid_cmd = true;
   if (planner_type == TRAJECTORY_PLANNER) {
-    valid_cmd = tc_->CheckTrajectoryWithSimTime(global_pose.getOrigin().getX(), global_pose.getOrigin().getY(), yaw,
-                                                robot_vel.getOrigin().getX(), robot_vel.getOrigin().getY(), vel_yaw, vx, vy, vth, 2.0);
+    valid_cmd = tc_->checkStopping(global_pose.getOrigin().getX(), global_pose.getOrigin().getY(), yaw,
+                                   robot_vel.getOrigin().getX(), robot_vel.getOrigin().getY());
   } else if (planner_type == LOOKAHEAD_PLANNER) {
     valid_cmd = la_->CheckTrajectory(global_pose.getOrigin().getX(), global_pose.getOrigin().getY(), yaw,
                                      robot_vel.getOrigin().getX(), robot_vel.getOrigin().getY(), vel_yaw, vx, vy, vth);
@@ -279,14 +341,13 @@ bool FixPatternTrajectoryPlannerROS::rotateToGoal(PlannerType planner_type, cons
   if (fabs(v_theta_samp) < min_vel_abs_th_) {
     v_theta_samp = v_theta_samp < 0.0 ? -1.0 * min_vel_abs_th_ : min_vel_abs_th_;
   }
-  // we still want to lay down the footprint of the robot and check if the action is legal
+  // we still want to lay down the footprint of the robot and check if the action is legal,
+  // in place rotation only needs the arc up to goal heading, or further if we can't brake before it
   bool valid_cmd = true;
   if (planner_type == TRAJECTORY_PLANNER) {
-    valid_cmd = tc_->checkTrajectory(global_pose.getOrigin().getX(),
-                                     global_pose.getOrigin().getY(), yaw,
-                                     robot_vel.getOrigin().getX(),
-                                     robot_vel.getOrigin().getY(),
-                                     vel_yaw, 0.0, 0.0, v_theta_samp);
+    valid_cmd = tc_->checkInPlaceRotation(global_pose.getOrigin().getX(),
+                                          global_pose.getOrigin().getY(), yaw,
+                                          v_theta_samp, ang_diff);
   } else if (planner_type == LOOKAHEAD_PLANNER) {
     valid_cmd = la_->CheckTrajectory(global_pose.getOrigin().getX(),
                                      global_pose.getOrigin().getY(), yaw,
@@ -366,49 +427,150 @@ double getPoseDistance(geometry_msgs::PoseStamped start_pose, geometry_msgs::Pos
     return hypot(start_pose.pose.position.x- end_pose.pose.position.x, start_pose.pose.position.y- end_pose.pose.position.y);
 }
 
-double getPlanLength(const std::vector<fixpattern_path::PathPoint>& plan) {
-  if (plan.size() <= 0)
-    return 0.0;
-  double length = 0.0;
-  for (int i = 0; i < plan.size() - 1; ++i)
-    length += plan.at(i).DistanceToPoint(plan.at(i + 1));
-  return length;
+bool isPlanShorterThan(const std::vector<fixpattern_path::PathPoint>& plan, size_t begin, double length) {
+  double acc_length = 0.0;
+  for (size_t i = begin; i + 1 < plan.size(); ++i) {
+    acc_length += plan.at(i).DistanceToPoint(plan.at(i + 1));
+    if (acc_length >= length) return false;
+  }
+  return true;
+}
+
+// points that give the same PoseStamped
+bool isSamePathPose(const fixpattern_path::PathPoint& a, const fixpattern_path::PathPoint& b) {
+  return a.position.x == b.position.x && a.position.y == b.position.y &&
+         a.orientation.z == b.orientation.z && a.orientation.w == b.orientation.w;
 }
 
 bool FixPatternTrajectoryPlannerROS::setPlan(const std::vector<fixpattern_path::PathPoint>& orig_global_plan, const std::string& orig_frame_id) {
+  // a plan equal to the end of the last one is the same path pruned, keep its source and profile
+  if (plan_source_ && orig_frame_id == plan_frame_id_ && !orig_global_plan.empty() &&
+      orig_global_plan.size() <= plan_source_->size()) {
+    size_t offset = plan_source_->size() - orig_global_plan.size();
+    size_t i = 0;
+    while (i < orig_global_plan.size() && isSamePathPose(orig_global_plan[i], (*plan_source_)[offset + i])) ++i;
+    if (i == orig_global_plan.size()) return setPlan(plan_source_, offset, orig_frame_id);
+  }
+  return setPlan(std::make_shared<const std::vector<fixpattern_path::PathPoint> >(orig_global_plan), 0, orig_frame_id);
+}
+
+std::shared_ptr<const VelocityProfile> FixPatternTrajectoryPlannerROS::makeVelocityProfile(
+    const std::vector<fixpattern_path::PathPoint>& path) const {
+  std::shared_ptr<VelocityProfile> profile = std::make_shared<VelocityProfile>(profile_limits_);
+  profile->Compute(path, 0);
+  return profile;
+}
+
+double FixPatternTrajectoryPlannerROS::pathVelocity(size_t i) {
+  size_t index = plan_offset_ + i;
+  double vel;
+  if (!velocity_profile_ || !velocity_profile_->Velocity(index, &vel)) return pathPoint(i).max_vel;
+  // costmap is in global frame, a plan in another frame tracks the profile only
+  if (plan_frame_id_ != global_frame_) return vel;
+
+  if (clearance_vel_ < 0.0 || clearance_index_ != index || clearance_revision_ != costmap_revision_) {
+    velocity_profile_->ClearanceVelocity(*plan_source_, index, *costmap_, &clearance_vel_);
+    clearance_index_ = index;
+    clearance_revision_ = costmap_revision_;
+  }
+  return clearance_vel_;
+}
+
+bool FixPatternTrajectoryPlannerROS::setPlan(const std::shared_ptr<const std::vector<fixpattern_path::PathPoint> >& path,
+                                             size_t offset, const std::string& frame_id,
+                                             const std::shared_ptr<const VelocityProfile>& profile) {
   if (!isInitialized()) {
     GAUSSIAN_ERROR("This planner has not been initialized, please call initialize() before using this planner");
     return false;
   }
+  if (!path || offset >= path->size()) {
+    GAUSSIAN_ERROR("[FIXPATTERN LOCAL PLANNER] empty plan passed to setPlan");
+    return false;
+  }
+
+  const std::vector<fixpattern_path::PathPoint>& new_path = *path;
+  size_t new_size = new_path.size() - offset;
 
-  global_goal_ = fixpattern_path::PathPointToGeometryPoseStamped(orig_global_plan.back());
-  global_goal_.header.frame_id = orig_frame_id;
+  global_goal_ = fixpattern_path::PathPointToGeometryPoseStamped(new_path.back());
+  global_goal_.header.frame_id = frame_id;
+
+  // global_plan_ is the conversion of the last old_size points of last plan, since
+  // prunePlan only erases from its front. Drop the extension, it is rebuilt below
+  size_t old_size = 0;
+  if (plan_source_ && frame_id == plan_frame_id_ && global_plan_.size() >= plan_extension_) {
+    old_size = std::min(global_plan_.size() - plan_extension_, pathSize());
+  }
+  global_plan_.resize(old_size);
+  size_t old_begin = plan_source_ ? plan_source_->size() - old_size : 0;
+
+  // unchanged suffix, then unchanged prefix of what is left
+  size_t suffix = 0, prefix = 0;
+  size_t max_common = std::min(old_size, new_size);
+  if (path == plan_source_) {
+    suffix = max_common;
+  } else {
+    while (suffix < max_common &&
+           isSamePathPose(new_path[new_path.size() - 1 - suffix], (*plan_source_)[plan_source_->size() - 1 - suffix])) {
+      ++suffix;
+    }
+  }
+  while (prefix < max_common - suffix &&
+         isSamePathPose(new_path[offset + prefix], (*plan_source_)[old_begin + prefix])) {
+    ++prefix;
+  }
+
+  // replace the changed middle
+  size_t old_changed = old_size - prefix - suffix;
+  size_t new_changed = new_size - prefix - suffix;
+  std::vector<geometry_msgs::PoseStamped>::iterator it = global_plan_.begin() + prefix;
+  if (new_changed < old_changed) {
+    it = global_plan_.erase(it, it + (old_changed - new_changed));
+  } else if (new_changed > old_changed) {
+    it = global_plan_.insert(it, new_changed - old_changed, geometry_msgs::PoseStamped());
+  }
+  for (size_t i = 0; i < new_changed; ++i, ++it) {
+    *it = fixpattern_path::PathPointToGeometryPoseStamped(new_path[offset + prefix + i]);
+    it->header.frame_id = frame_id;
+  }
+
+  // the profile covers all of plan_source_, a moved offset on the same path reuses it. The
+  // thread making the path passes one in, a path made on this thread is profiled here
+  bool new_source = path != plan_source_ || offset < plan_offset_ || frame_id != plan_frame_id_;
+  if (profile) {
+    velocity_profile_ = profile;
+  } else if (new_source) {
+    velocity_profile_ = makeVelocityProfile(new_path);
+  }
+  if (new_source || profile) clearance_vel_ = -1.0;
+
+  plan_source_ = path;
+  plan_offset_ = offset;
+  plan_frame_id_ = frame_id;
 
-  std::vector<fixpattern_path::PathPoint> new_global_plan = orig_global_plan;
   // if global plan is too short, we will extend it to avoid robot shaking when ariving global goal
-  if (getPlanLength(new_global_plan) < final_goal_dis_th_ && new_global_plan.size() > 2) {
-   // extend path
-    double yaw = fixpattern_path::CalculateDirection(new_global_plan.front(), new_global_plan.back());
+  size_t old_extension = plan_extension_;
+  plan_extension_ = 0;
+  if (new_size > 2 && isPlanShorterThan(new_path, offset, final_goal_dis_th_)) {
+    // extend path
+    double yaw = fixpattern_path::CalculateDirection(new_path[offset], new_path.back());
+    fixpattern_path::PathPoint extended = new_path.back();
     for (int i = 0; i < 10; ++i) {
-      new_global_plan.push_back(new_global_plan.back());
-      new_global_plan.back().position.x += 0.05 * cos(yaw);
-      new_global_plan.back().position.y += 0.05 * sin(yaw);
+      extended.position.x += 0.05 * cos(yaw);
+      extended.position.y += 0.05 * sin(yaw);
+      global_plan_.push_back(fixpattern_path::PathPointToGeometryPoseStamped(extended));
+      global_plan_.back().header.frame_id = frame_id;
     }
+    plan_extension_ = 10;
     final_goal_extended_ = true;
   } else {
     final_goal_extended_ = false;
   }
 
-//  GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] orig plan size = %zu; new plan size = %zu", orig_global_plan.size(), new_global_plan.size());
-
-  // reset the global plan
-  global_plan_.clear();
-  for (const auto& p : new_global_plan) {
-    geometry_msgs::PoseStamped pose = fixpattern_path::PathPointToGeometryPoseStamped(p);
-    pose.header.frame_id = orig_frame_id;
-    global_plan_.push_back(pose);
+  // like the profile, the path grid covers global_plan_ as a whole and local plans are
+  // ranges of it. It's in plan frame, so only usable when that is the costmap frame
+  if (new_source || plan_extension_ != old_extension) {
+    tc_->UpdatePathGrid(frame_id == global_frame_ ? global_plan_ : std::vector<geometry_msgs::PoseStamped>());
   }
-  fixpattern_path_ = orig_global_plan;
 
   // // when we get a new plan, we also want to clear any latch we may have on goal tolerances
   // xy_tolerance_latch_ = false;
@@ -423,8 +585,8 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
     return false;
   }
 
-  if (fixpattern_path_.size() == 0) {
-    GAUSSIAN_ERROR("[FIXPATTERN LOCAL PLANNER] fixpattern_path_.size() == 0");
+  if (pathSize() == 0) {
+    GAUSSIAN_ERROR("[FIXPATTERN LOCAL PLANNER] plan is empty");
     return false;
   }
 
@@ -438,7 +600,7 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
   std::vector<geometry_msgs::PoseStamped> transformed_plan;
   // get the global plan in our frame
   if (!transformGlobalPlan(*tf_, global_plan_, global_pose, *costmap_,
-                           global_frame_, transformed_plan, fixpattern_path_.front().highlight)) {
+                           global_frame_, transformed_plan, pathPoint(0).highlight)) {
     GAUSSIAN_ERROR("Could not transform the global plan to the frame of the controller");
     return false;
   }
@@ -530,8 +692,8 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
         la_->UpdatePlan(transformed_plan);
       }
       std::vector<Trajectory> all_explored;
-      double traj_vel = fixpattern_path_.front().max_vel;
-      double highlight = fixpattern_path_.front().highlight;
+      double traj_vel = pathVelocity(0);
+      double highlight = pathPoint(0).highlight;
       double current_point_dis = getGoalPositionDistance(global_pose, current_point.getOrigin().getX(), current_point.getOrigin().getY());
       Trajectory path;
       if (planner_type == TRAJECTORY_PLANNER) {
@@ -542,9 +704,12 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
       }
       is_footprint_safe_ = path.is_footprint_safe_;
 
-      // copy over the odometry information
+      // copy over the odometry information, odometry jitters around zero
+      // while the robot stops, so check the filtered estimate
       nav_msgs::Odometry base_odom;
       odom_helper_.getOdom(base_odom);
+      odom_helper_.getFilteredRobotVel(&base_odom.twist.twist.linear.x, &base_odom.twist.twist.linear.y,
+                                       &base_odom.twist.twist.angular.z);
 
       // if we're not stopped yet... we want to stop... taking into account the acceleration limits of the robot
       if (!rotating_to_goal_ && !fixpattern_local_planner::stopped(base_odom, 0.1, 0.1)) { //trans_stopped_velocity_  rot_stopped_velocity_
@@ -580,16 +745,18 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
 
   // compute what trajectory to drive along
   std::vector<Trajectory> all_explored;
-  double traj_vel = fixpattern_path_.front().max_vel;
-  double highlight = fixpattern_path_.front().highlight;
+  double traj_vel = pathVelocity(0);
+  double highlight = pathPoint(0).highlight;
   double current_point_dis = getGoalPositionDistance(global_pose, current_point.getOrigin().getX(), current_point.getOrigin().getY());
   GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] path_front.max_vel = %lf, hightlight = %lf, current_ponit_dis = %lf", traj_vel, highlight, current_point_dis);
   Trajectory path;
+  ros::WallTime planner_start = ros::WallTime::now();
   if (planner_type == TRAJECTORY_PLANNER) {
     path = tc_->findBestPath(global_pose, traj_vel, highlight, current_point_dis, robot_vel, drive_cmds, &all_explored);
   } else if (planner_type == LOOKAHEAD_PLANNER) {
     path = la_->GeneratePath(global_pose, robot_vel, traj_vel, highlight, &drive_cmds);
   }
+  recordPlannerStats(planner_type, (ros::WallTime::now() - planner_start).toSec());
   is_footprint_safe_ = path.is_footprint_safe_;
 
   /* For timing uncomment
@@ -600,13 +767,13 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
      GAUSSIAN_INFO("Cycle time: %.9f", t_diff);
  */
 
-  // GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] fixpattern_path_.size(): %d", fixpattern_path_.size());
-  for(unsigned int i = 0; i < fixpattern_path_.size(); ++i) {
-    if(fixpattern_path_.at(i).IsCornerPoint()) {
-      GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] fixpattern_path_size = %d, corner_index = %d", (int)fixpattern_path_.size(), i);
+  // GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] path size: %d", pathSize());
+  for(unsigned int i = 0; i < pathSize(); ++i) {
+    if(pathPoint(i).IsCornerPoint()) {
+      GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] fixpattern_path_size = %d, corner_index = %d", (int)pathSize(), i);
     }
   }
-  if (fixpattern_path_.front().IsCornerPoint()) {
+  if (pathPoint(0).IsCornerPoint()) {
 /*
     if (needBackward(planner_type, global_pose, robot_vel, cmd_vel)) {
       publishPlan(transformed_plan, g_plan_pub_);
@@ -616,7 +783,7 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
     }
 */
     double yaw = tf::getYaw(global_pose.getRotation());
-    double target_yaw = fixpattern_path_.front().corner_struct.theta_out;
+    double target_yaw = pathPoint(0).corner_struct.theta_out;
     double angle_diff = angles::shortest_angular_distance(yaw, target_yaw);
     GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] Corner: before rotating to goal, yaw: %lf, target_yaw: %lf, angle_diff: %lf", yaw, target_yaw, angle_diff);
     // if target_yaw changed during rotation, don't follow last dir
@@ -647,12 +814,12 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
 		double yaw = tf::getYaw(global_pose.getRotation());
 		double acc_dis = 0.0;
 		unsigned int index = 1;
-		for (; index < fixpattern_path_.size() - 2; index++) {
-			acc_dis += fixpattern_path_.at(index).DistanceToPoint(fixpattern_path_.at(index - 1));
+		for (; index < pathSize() - 2; index++) {
+			acc_dis += pathPoint(index).DistanceToPoint(pathPoint(index - 1));
 			//acc_dis += getPoseDistance(transformed_plan.at(index), tranformed_plan.at(index + 1));
 			if (acc_dis > 0.1) break;
 		}
-		double target_yaw = fixpattern_path::CalculateDirection(fixpattern_path_.front(), fixpattern_path_.at(index));
+		double target_yaw = fixpattern_path::CalculateDirection(pathPoint(0), pathPoint(index));
 		double angle_diff = angles::shortest_angular_distance(yaw, target_yaw);
 		if (robot_vel.getOrigin().getX() < GS_DOUBLE_PRECISION && tf::getYaw(robot_vel.getRotation()) < GS_DOUBLE_PRECISION && fabs(angle_diff) > 0.5) {  // > 30 digree{
         need_rotate_to_path_ = true;
@@ -677,8 +844,8 @@ bool FixPatternTrajectoryPlannerROS::computeVelocityCommands(PlannerType planner
   last_rotate_to_goal_dir_ = 0;
   try_rotate_ = 0;
 
-  if (fixpattern_path_.front().IsCornerPoint()) {
-    GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] path front is corner, highlight: %lf", fixpattern_path_.front().highlight);
+  if (pathPoint(0).IsCornerPoint()) {
+    GAUSSIAN_INFO("[FIXPATTERN LOCAL PLANNER] path front is corner, highlight: %lf", pathPoint(0).highlight);
   }
 
   // publish point cloud for debug
@@ -0,0 +1,90 @@
+/* Copyright(C) Gaussian Robot. All rights reserved.
+ */
+
+/**
+ * @file velocity_profile.cpp
+ * @brief path-wide velocity profile, limited by curvature, clearance and acceleration
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-20
+ */
+
+#include <fixpattern_local_planner/velocity_profile.h>
+#include <costmap_2d/cost_values.h>
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+
+namespace fixpattern_local_planner {
+
+VelocityProfile::VelocityProfile()
+  : max_vel_x_(0.5), min_vel_x_(0.08), max_vel_theta_(1.0), acc_lim_x_(2.5), offset_(0) { }
+
+VelocityProfile::~VelocityProfile() { }
+
+void VelocityProfile::SetLimits(double max_vel_x, double min_vel_x, double max_vel_theta, double acc_lim_x) {
+  max_vel_x_ = max_vel_x;
+  min_vel_x_ = min_vel_x;
+  max_vel_theta_ = max_vel_theta;
+  acc_lim_x_ = acc_lim_x;
+}
+
+void VelocityProfile::Compute(const std::vector<fixpattern_path::PathPoint>& path, size_t offset) {
+  offset_ = offset;
+  vel_.clear();
+  if (offset >= path.size()) return;
+  vel_.resize(path.size() - offset);
+
+  // limit of each point by itself
+  for (size_t i = 0; i < vel_.size(); ++i) {
+    const fixpattern_path::PathPoint& point = path[offset + i];
+    double vel = std::min(max_vel_x_, point.max_vel);
+    if (point.radius > 0.0) vel = std::min(vel, max_vel_theta_ * point.radius);
+
+    // robot stops at corners to rotate in place, and at the goal
+    if (point.IsCornerPoint()) vel = 0.0;
+    vel_[i] = std::max(0.0, vel);
+  }
+  vel_.back() = 0.0;
+
+  // be able to brake for every point ahead, then to reach every point from the one behind
+  for (size_t i = vel_.size() - 1; i > 0; --i) {
+    double dis = path[offset + i - 1].DistanceToPoint(path[offset + i]);
+    vel_[i - 1] = std::min(vel_[i - 1], sqrt(vel_[i] * vel_[i] + 2.0 * acc_lim_x_ * dis));
+  }
+  for (size_t i = 1; i < vel_.size(); ++i) {
+    double dis = path[offset + i - 1].DistanceToPoint(path[offset + i]);
+    vel_[i] = std::min(vel_[i], sqrt(vel_[i - 1] * vel_[i - 1] + 2.0 * acc_lim_x_ * dis));
+  }
+}
+
+bool VelocityProfile::Velocity(size_t index, double* vel) const {
+  if (index < offset_ || index - offset_ >= vel_.size()) return false;
+  *vel = vel_[index - offset_];
+  return true;
+}
+
+bool VelocityProfile::ClearanceVelocity(const std::vector<fixpattern_path::PathPoint>& path, size_t index,
+                                        const costmap_2d::Costmap2D& costmap, double* vel) const {
+  if (!Velocity(index, vel)) return false;
+
+  // from max_vel_x_ the robot brakes to anything within this distance
+  double brake_dis = acc_lim_x_ > 0.0 ? max_vel_x_ * max_vel_x_ / (2.0 * acc_lim_x_) : DBL_MAX;
+  double dis = 0.0;
+  for (size_t i = index; i < offset_ + vel_.size() && dis <= brake_dis; ++i) {
+    if (i > index) dis += path[i - 1].DistanceToPoint(path[i]);
+
+    // slow down where the costmap says obstacles are close, never below min_vel_x_
+    unsigned int cell_x, cell_y;
+    if (!costmap.worldToMap(path[i].position.x, path[i].position.y, cell_x, cell_y)) continue;
+    unsigned char cost = costmap.getCost(cell_x, cell_y);
+    double ratio = 1.0 - std::min(1.0, static_cast<double>(cost) / costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+    double limit = std::min(vel_[i - offset_], min_vel_x_ + (max_vel_x_ - min_vel_x_) * ratio);
+    *vel = std::min(*vel, sqrt(limit * limit + 2.0 * acc_lim_x_ * dis));
+  }
+  return true;
+}
+
+};  // namespace fixpattern_local_planner
@@ -13,13 +13,20 @@
 #define SEARCH_BASED_GLOBAL_PLANNER_INCLUDE_SEARCH_BASED_GLOBAL_PLANNER_ENVIRONMENT_H_
 
 #include <vector>
+#include <algorithm>
 #include <gslib/gaussian_debug.h>
 #include "search_based_global_planner/utils.h"
 #include "search_based_global_planner/pointer_heap.h"
 #include "search_based_global_planner/motion_primitive_manager.h"
+#include "search_based_global_planner/row_workers.h"
 
 #define NUM_OF_HEURISTIC_SEARCH_DIR 16
 
+// 3d entries are stored in pages of ENV_PAGE_SIZE x ENV_PAGE_SIZE cells, all thetas
+#define ENV_PAGE_BITS 3
+#define ENV_PAGE_SIZE (1 << ENV_PAGE_BITS)
+#define ENV_PAGE_MASK (ENV_PAGE_SIZE - 1)
+
 namespace search_based_global_planner {
 
 #define XYTHETA2INDEX(x, y, theta) (theta + x * num_of_angles_ + y * size_x_ * num_of_angles_)
@@ -97,7 +104,11 @@ class Environment {
               int forward_and_turn_cost_mult, int turn_in_place_cost_mult);
   ~Environment();
 
-  void ReInitialize();
+  void ReInitialize(RowWorkers* workers = NULL);
+  // reset 3d entries only, heuristics are kept
+  void ReInitializeEntries();
+  // goals besides goal_cell_ the heuristics must cover, switching among them won't update heuristics
+  void SetHeuristicGoals(const std::vector<XYCell>& cells);
   EnvironmentEntry3D* SetStart(double x_m, double y_m, double theta_rad);
   EnvironmentEntry3D* SetGoal(double x_m, double y_m, double theta_rad);
   void UpdateCost(unsigned int x, unsigned int y, unsigned char cost);
@@ -108,7 +119,14 @@ class Environment {
 
   EnvironmentEntry3D* GetEnvEntry(unsigned int x, unsigned int y, unsigned int theta) {
     if (!IsWithinMapCell(x, y) || theta >= num_of_angles_) return NULL;
-    return &env_[x][y][theta];
+    return TouchEnvEntry(x, y, theta);
+  }
+  // like GetEnvEntry, but NULL if the entry is untouched since ReInitialize, won't materialize it
+  EnvironmentEntry3D* FindEnvEntry(unsigned int x, unsigned int y, unsigned int theta) {
+    if (!IsWithinMapCell(x, y) || theta >= num_of_angles_) return NULL;
+    unsigned int page = PageIndex(x, y);
+    if (page_generation_[page] != generation_) return NULL;
+    return &pages_[page][PageOffset(x, y, theta)];
   }
   unsigned char GetCost(unsigned int x, unsigned int y) {
     if (!IsWithinMapCell(x, y)) return obstacle_threshold_;
@@ -134,9 +152,27 @@ class Environment {
     return IsWithinMapCell(x, y) && grid_[x][y].cost < cost_inscribed_thresh_;
   }
   bool IsValidConfiguration(int cell_x, int cell_y, int theta);
+  bool IsHeuristicGoal(int x, int y) {
+    return std::find(heuristic_goal_cells_.begin(), heuristic_goal_cells_.end(), XYCell(x, y)) != heuristic_goal_cells_.end();
+  }
+  unsigned int PageIndex(unsigned int x, unsigned int y) {
+    return (y >> ENV_PAGE_BITS) * num_of_pages_x_ + (x >> ENV_PAGE_BITS);
+  }
+  unsigned int PageOffset(unsigned int x, unsigned int y, unsigned int theta) {
+    return (((y & ENV_PAGE_MASK) << ENV_PAGE_BITS) + (x & ENV_PAGE_MASK)) * size_dir_ + theta;
+  }
+  // x, y must be within map, page of the entry is allocated or reset on first touch in a generation
+  EnvironmentEntry3D* TouchEnvEntry(unsigned int x, unsigned int y, unsigned int theta) {
+    unsigned int page = PageIndex(x, y);
+    if (page_generation_[page] != generation_) RefreshPage(page);
+    return &pages_[page][PageOffset(x, y, theta)];
+  }
+  void RefreshPage(unsigned int page);
   void ComputeDXY();
   int ComputeActionCost(int source_x, int source_y, int source_theta, Action* action);
   bool ComputeHeuristicValues();
+  int LargestHeuristic(const std::vector<EnvironmentEntry2D*>& spaces);
+  void ReInitializeRows(unsigned int begin_x, unsigned int end_x);
 
  private:
   unsigned int size_x_;
@@ -146,7 +182,12 @@ class Environment {
   XYThetaCell start_cell_;
   XYThetaCell goal_cell_;
 
-  EnvironmentEntry3D*** env_;
+  // pages of 3d entries, NULL until first touched. a page whose generation is not
+  // generation_ holds stale entries of a previous search, ReInitialize only bumps generation_
+  std::vector<EnvironmentEntry3D*> pages_;
+  std::vector<unsigned int> page_generation_;
+  unsigned int generation_;
+  unsigned int num_of_pages_x_;
   EnvironmentEntry2D** grid_;
 
   double resolution_;
@@ -160,6 +201,7 @@ class Environment {
   bool need_to_update_heuristics_;
   int iteration_;
   int largest_computed_heuristic_;
+  std::vector<XYCell> heuristic_goal_cells_;
   int heuristic_dx_[NUM_OF_HEURISTIC_SEARCH_DIR];
   int heuristic_dy_[NUM_OF_HEURISTIC_SEARCH_DIR];
   // the intermediate cells through which the actions go
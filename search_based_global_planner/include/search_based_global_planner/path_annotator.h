@@ -0,0 +1,88 @@
+/* Copyright(C) Gaussian Automation. All rights reserved.
+*/
+
+/**
+ * @file path_annotator.h
+ * @brief streaming annotator of corners, highlight and speed limits along a planned path
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2015-09-04
+ */
+
+#ifndef SEARCH_BASED_GLOBAL_PLANNER_INCLUDE_SEARCH_BASED_GLOBAL_PLANNER_PATH_ANNOTATOR_H_
+#define SEARCH_BASED_GLOBAL_PLANNER_INCLUDE_SEARCH_BASED_GLOBAL_PLANNER_PATH_ANNOTATOR_H_
+
+#include <fixpattern_path/path.h>
+#include <gslib/gaussian_debug.h>
+#include <vector>
+
+#include "search_based_global_planner/utils.h"
+
+namespace search_based_global_planner {
+
+const double MAX_HIGHLIGHT_DIS = fixpattern_path::Path::MAX_HIGHLIGHT_DISTANCE * 2.0 / 3.0;
+const double LOW_HIGHLIGHT_DIS = 0.7;
+const double MIN_HIGHLIGHT_DIS = fixpattern_path::Path::MIN_HIGHLIGHT_DISTANCE;
+
+/**
+ * @class PathAnnotator
+ * @brief Keeps a path of poses with their annotation: distance to next point, radius,
+ *        corner, max_vel and highlight. Input infos mark in-place rotation points with
+ *        is_corner and carry the nominal max_vel of the others, a run of rotation
+ *        points is then graded by its angle. Splice only re-annotates the points whose
+ *        annotation can reach the replaced portion.
+ */
+class PathAnnotator {
+ public:
+  PathAnnotator();
+  ~PathAnnotator();
+
+  void SetVelocities(double max_vel, double low_vel, double min_vel);
+  void SetUsingShortHighlight(bool using_short_highlight) { using_short_highlight_ = using_short_highlight; }
+
+  void Clear();
+
+  /**
+   * @brief  Replace points from begin on, then annotate them
+   * @param begin Index of the first replaced point, clamped to the path size
+   * @param points New poses
+   * @param infos Raw infos of the new poses, same size as points
+   */
+  void Splice(unsigned int begin, const std::vector<XYThetaPoint>& points,
+              const std::vector<IntermPointStruct>& infos);
+  void Append(const std::vector<XYThetaPoint>& points, const std::vector<IntermPointStruct>& infos) {
+    Splice(points_.size(), points, infos);
+  }
+
+  /**
+   * @brief  Replace the whole path, splicing from the first point that differs from the kept one
+   * @return Index of the first replaced point, points before it kept their annotation
+   */
+  unsigned int Assign(const std::vector<XYThetaPoint>& points, const std::vector<IntermPointStruct>& infos);
+
+  /**
+   * @brief  Convert to path points, a corner run of rotation points becomes one corner point
+   * @param offset_x Added to x of every point
+   * @param offset_y Added to y of every point
+   */
+  void GetPathPoints(double offset_x, double offset_y, std::vector<fixpattern_path::PathPoint>* path) const;
+
+  const std::vector<XYThetaPoint>& points() const { return points_; }
+  const std::vector<IntermPointStruct>& infos() const { return infos_; }
+
+ private:
+  void AnnotateVelocity(unsigned int begin);
+  void AnnotateHighlight(unsigned int begin);
+  unsigned int RotationRunBegin(unsigned int index) const;
+
+  double max_vel_, low_vel_, min_vel_;
+  bool using_short_highlight_;
+
+  std::vector<XYThetaPoint> points_;
+  std::vector<IntermPointStruct> raw_infos_;  // as given to Splice
+  std::vector<IntermPointStruct> infos_;      // annotated
+};
+
+};  // namespace search_based_global_planner
+
+#endif  // SEARCH_BASED_GLOBAL_PLANNER_INCLUDE_SEARCH_BASED_GLOBAL_PLANNER_PATH_ANNOTATOR_H_
@@ -0,0 +1,60 @@
+/* Copyright(C) Gaussian Automation. All rights reserved.
+*/
+
+/**
+ * @file row_workers.h
+ * @brief persistent worker threads splitting bulk row loops
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2015-09-07
+ */
+
+#ifndef SEARCH_BASED_GLOBAL_PLANNER_INCLUDE_SEARCH_BASED_GLOBAL_PLANNER_ROW_WORKERS_H_
+#define SEARCH_BASED_GLOBAL_PLANNER_INCLUDE_SEARCH_BASED_GLOBAL_PLANNER_ROW_WORKERS_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace search_based_global_planner {
+
+typedef std::function<void(unsigned int begin, unsigned int end)> RowTask;
+
+class RowWorkers {
+ public:
+  /**
+   * @brief  Start num_threads - 1 workers, the calling thread of Run is the last one
+   * @param  num_threads Number of threads sharing a Run, 0 for hardware concurrency
+   */
+  explicit RowWorkers(unsigned int num_threads);
+  ~RowWorkers();
+
+  /**
+   * @brief  Split rows [0, num_rows) into contiguous ranges, one per thread, and call
+   *         task on each of them. Returns when all ranges are done, so ranges must only
+   *         write to their own rows
+   */
+  void Run(unsigned int num_rows, const RowTask& task);
+
+  unsigned int NumThreads() const { return num_threads_; }
+
+ private:
+  void WorkerLoop(unsigned int index);
+
+  unsigned int num_threads_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const RowTask* task_;
+  unsigned int num_rows_;
+  unsigned int generation_;  // bumped by every Run
+  unsigned int pending_;     // workers not done with this Run
+  bool stop_;
+};
+
+};  // namespace search_based_global_planner
+
+#endif  // SEARCH_BASED_GLOBAL_PLANNER_INCLUDE_SEARCH_BASED_GLOBAL_PLANNER_ROW_WORKERS_H_
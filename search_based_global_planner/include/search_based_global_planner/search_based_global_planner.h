@@ -20,6 +20,7 @@
 #include <string>
 
 #include "search_based_global_planner/environment.h"
+#include "search_based_global_planner/path_annotator.h"
 #include "search_based_global_planner/pointer_heap.h"
 
 namespace search_based_global_planner {
@@ -60,6 +61,21 @@ class SearchBasedGlobalPlanner {
                 geometry_msgs::PoseStamped goal,
                 std::vector<geometry_msgs::PoseStamped>& plan,
                 fixpattern_path::Path& path, bool broader_start_and_goal, bool extend_path);  // NOLINT
+  /**
+   * @brief Given several candidate goals, compute a plan from start to each of them. All goals
+   *        share one snapshot of the costmap and the heuristics from start, each goal then gets
+   *        a fresh search stopped at its first solution, so a plan doesn't depend on the other
+   *        goals or their order. All searches share one allocated_time_, goals left when it
+   *        runs out get no plan
+   * @param start The start pose
+   * @param goals Candidate goals, within the sbpl window around start
+   * @param plans One plan per goal, empty if no plan was found to it
+   * @param paths One path per goal
+   * @return Number of goals a plan was found to
+   */
+  int makePlans(const geometry_msgs::PoseStamped& start, const std::vector<geometry_msgs::PoseStamped>& goals,
+                std::vector<std::vector<geometry_msgs::PoseStamped> >* plans,
+                std::vector<fixpattern_path::Path>* paths, bool broader_start_and_goal);
   /**
    * @brief  setStaticCosmap function for the SBPL Planner
    * @param  name The name of this planner
@@ -77,10 +93,15 @@ class SearchBasedGlobalPlanner {
   void PublishPlan(const std::vector<geometry_msgs::PoseStamped>& plan);
   void GetPointPathFromEntryPath(const std::vector<EnvironmentEntry3D*>& entry_path,
                                  std::vector<XYThetaPoint>* point_path, std::vector<IntermPointStruct>* path_info);
-  void ComputeHighlightAndVelocity(const std::vector<Action>& actions_path, 
-                                 std::vector<XYThetaPoint>* point_path, std::vector<IntermPointStruct>* path_info);
-  void ReInitializeSearchEnvironment();
+  void ReInitializeSearchEnvironment(bool keep_heuristics = false);
+  bool GetWindowOrigin(const geometry_msgs::PoseStamped& start, unsigned int* start_cell_x, unsigned int* start_cell_y,
+                       double* start_x, double* start_y);
+  void FillPlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
+                double start_x, double start_y, std::vector<XYThetaPoint>* point_path,
+                std::vector<geometry_msgs::PoseStamped>* plan);
+  fixpattern_path::PathPoint GoalPathPoint(const geometry_msgs::PoseStamped& goal);
   unsigned char TransformCostmapCost(unsigned char cost);
+  void UpdateWindowCosts(unsigned int start_cell_x, unsigned int start_cell_y, std::vector<XYCell>* changed_cells);
   bool CostsChanged(const std::vector<XYCell>& changed_cells);
   bool ReadCircleCenterFromParams(ros::NodeHandle& nh, std::vector<XYPoint>* points);
 
@@ -98,6 +119,10 @@ class SearchBasedGlobalPlanner {
   unsigned char lethal_cost_;
   unsigned char inscribed_inflated_cost_;
   unsigned char cost_multiplier_;
+  unsigned char cost_lut_[256];  // TransformCostmapCost of every costmap value
+  std::vector<unsigned char> window_costs_;  // transformed costs of the sbpl window, row-major
+  std::vector<std::vector<XYCell> > changed_columns_;  // changed cells of each x, found in parallel
+  RowWorkers* workers_;
   int map_size_;
   bool using_short_highlight_;
   unsigned int size_dir_;
@@ -113,6 +138,7 @@ class SearchBasedGlobalPlanner {
   bool initialized_;
   bool broader_start_and_goal_;
   std::vector<EnvironmentEntry3D*> goal_entry_list_;
+  PathAnnotator annotator_;  // annotation of the last plan, in global frame
 };
 
 };  // namespace search_based_global_planner
@@ -53,25 +53,13 @@ Environment::Environment(unsigned int size_x, unsigned int size_y, double resolu
     }
   }
 
-  // create environment entry
-  env_ = new EnvironmentEntry3D**[size_x_];
-  for (unsigned int i = 0; i < size_x_; ++i) {
-    env_[i] = new EnvironmentEntry3D*[size_y_];
-    for (unsigned int j = 0; j < size_y_; ++j) {
-      env_[i][j] = new EnvironmentEntry3D[size_dir_];
-      for (unsigned int k = 0; k < size_dir_; ++k) {
-        env_[i][j][k].x = i;
-        env_[i][j][k].y = j;
-        env_[i][j][k].theta = k;
-        env_[i][j][k].g = INFINITECOST;
-        env_[i][j][k].rhs = INFINITECOST;
-        env_[i][j][k].best_next_entry = NULL;
-        env_[i][j][k].heap_index = -1;
-        env_[i][j][k].visited_iteration = -1;
-        env_[i][j][k].closed_iteration = -1;
-      }
-    }
-  }
+  // environment entries are created on first touch
+  num_of_pages_x_ = (size_x_ + ENV_PAGE_MASK) >> ENV_PAGE_BITS;
+  unsigned int num_of_pages_y = (size_y_ + ENV_PAGE_MASK) >> ENV_PAGE_BITS;
+  pages_.assign(num_of_pages_x_ * num_of_pages_y, NULL);
+  page_generation_.assign(pages_.size(), 0);
+  generation_ = 1;
+  start_cell_ = goal_cell_ = XYThetaCell(-1, -1, -1);
 
   mprim_manager_->GenerateMotionPrimitives();
 }
@@ -158,13 +146,10 @@ Environment::~Environment() {
   }
 
   // delete environment
-  for (unsigned int i = 0; i < size_x_; ++i) {
-    for (unsigned int j = 0; j < size_y_; ++j) {
-      delete[] env_[i][j];
-    }
-    delete env_[i];
+  for (auto& page : pages_) {
+    delete[] page;
+    page = NULL;
   }
-  delete env_;
 
   // delete grid_
   for (unsigned int i = 0; i < size_x_; ++i) {
@@ -173,32 +158,73 @@ Environment::~Environment() {
   delete grid_;
 }
 
-void Environment::ReInitialize() {
+void Environment::ReInitialize(RowWorkers* workers) {
   // heuristic reinitialize
   iteration_ = 0;
   largest_computed_heuristic_ = 0;
   need_to_update_heuristics_ = true;
-  for (unsigned int i = 0; i < size_x_; ++i) {
+
+  ReInitializeEntries();
+
+  // rows of x are independent, reset them in parallel if we have workers
+  if (workers) {
+    workers->Run(size_x_, [this](unsigned int begin_x, unsigned int end_x) { ReInitializeRows(begin_x, end_x); });
+  } else {
+    ReInitializeRows(0, size_x_);
+  }
+}
+
+void Environment::ReInitializeEntries() {
+  // 3d entries are reset lazily page by page, but the planner keeps the start
+  // and goal entries it got before, so make them valid right now
+  ++generation_;
+  if (IsWithinMapCell(start_cell_.x, start_cell_.y)) TouchEnvEntry(start_cell_.x, start_cell_.y, 0);
+  if (IsWithinMapCell(goal_cell_.x, goal_cell_.y)) TouchEnvEntry(goal_cell_.x, goal_cell_.y, 0);
+}
+
+void Environment::SetHeuristicGoals(const std::vector<XYCell>& cells) {
+  if (cells == heuristic_goal_cells_) return;
+  heuristic_goal_cells_ = cells;
+  need_to_update_heuristics_ = true;
+}
+
+void Environment::ReInitializeRows(unsigned int begin_x, unsigned int end_x) {
+  for (unsigned int i = begin_x; i < end_x; ++i) {
     for (unsigned int j = 0; j < size_y_; ++j) {
       grid_[i][j].visited_iteration = -1;
       grid_[i][j].heap_index = -1;
       grid_[i][j].heuristic = INFINITECOST;
     }
   }
+}
 
-  // env_ reinitialize
-  for (unsigned int i = 0; i < size_x_; ++i) {
-    for (unsigned int j = 0; j < size_y_; ++j) {
-      for (unsigned int k = 0; k < size_dir_; ++k) {
-        env_[i][j][k].g = INFINITECOST;
-        env_[i][j][k].rhs = INFINITECOST;
-        env_[i][j][k].best_next_entry = NULL;
-        env_[i][j][k].heap_index = -1;
-        env_[i][j][k].visited_iteration = -1;
-        env_[i][j][k].closed_iteration = -1;
+void Environment::RefreshPage(unsigned int page) {
+  EnvironmentEntry3D* entries = pages_[page];
+  if (!entries) {
+    entries = pages_[page] = new EnvironmentEntry3D[ENV_PAGE_SIZE * ENV_PAGE_SIZE * size_dir_];
+    unsigned int page_x = (page % num_of_pages_x_) << ENV_PAGE_BITS;
+    unsigned int page_y = (page / num_of_pages_x_) << ENV_PAGE_BITS;
+    for (unsigned int j = 0; j < ENV_PAGE_SIZE; ++j) {
+      for (unsigned int i = 0; i < ENV_PAGE_SIZE; ++i) {
+        for (unsigned int k = 0; k < size_dir_; ++k) {
+          EnvironmentEntry3D* entry = &entries[PageOffset(i, j, k)];
+          entry->x = page_x + i;
+          entry->y = page_y + j;
+          entry->theta = k;
+        }
       }
     }
   }
+
+  for (unsigned int k = 0; k < ENV_PAGE_SIZE * ENV_PAGE_SIZE * size_dir_; ++k) {
+    entries[k].g = INFINITECOST;
+    entries[k].rhs = INFINITECOST;
+    entries[k].best_next_entry = NULL;
+    entries[k].heap_index = -1;
+    entries[k].visited_iteration = -1;
+    entries[k].closed_iteration = -1;
+  }
+  page_generation_[page] = generation_;
 }
 
 bool Environment::IsValidConfiguration(int cell_x, int cell_y, int theta) {
@@ -235,8 +261,8 @@ EnvironmentEntry3D* Environment::SetGoal(double x_m, double y_m, double theta_ra
     GAUSSIAN_WARN("[SEARCH BASED GLOBAL PLANNER] goal configuration %d %d %d is invalid", x, y, theta);
   }
 
-  // we're using backward search, once start changes, heuristics must be updated
-  if (x != goal_cell_.x || y != goal_cell_.y || theta != goal_cell_.theta) {
+  // heuristics stop expanding once goals are reached, a new goal needs them updated
+  if ((x != goal_cell_.x || y != goal_cell_.y || theta != goal_cell_.theta) && !IsHeuristicGoal(x, y)) {
     need_to_update_heuristics_ = true;
   }
 
@@ -244,7 +270,7 @@ EnvironmentEntry3D* Environment::SetGoal(double x_m, double y_m, double theta_ra
   goal_cell_.y = y;
   goal_cell_.theta = theta;
 
-  return &env_[x][y][theta];
+  return TouchEnvEntry(x, y, theta);
 }
 
 EnvironmentEntry3D* Environment::SetStart(double x_m, double y_m, double theta_rad) {
@@ -271,7 +297,7 @@ EnvironmentEntry3D* Environment::SetStart(double x_m, double y_m, double theta_r
   start_cell_.y = y;
   start_cell_.theta = theta;
 
-  return &env_[x][y][theta];
+  return TouchEnvEntry(x, y, theta);
 }
 
 void Environment::UpdateCost(unsigned int x, unsigned int y, unsigned char cost) {
@@ -287,6 +313,12 @@ void Environment::EnsureHeuristicsUpdated() {
   }
 }
 
+int Environment::LargestHeuristic(const std::vector<EnvironmentEntry2D*>& spaces) {
+  int heuristic = 0;
+  for (const auto& space : spaces) heuristic = std::max(heuristic, space->heuristic);
+  return heuristic;
+}
+
 bool Environment::ComputeHeuristicValues() {
   EnvironmentEntry2D* search_exp_space_ = NULL;
   EnvironmentEntry2D* search_pred_space_ = NULL;
@@ -302,6 +334,14 @@ bool Environment::ComputeHeuristicValues() {
   EnvironmentEntry2D* search_goal_space = &grid_[goal_cell_.x][goal_cell_.y];
   search_exp_space_->heuristic = search_goal_space->heuristic = INFINITECOST;
   search_exp_space_->visited_iteration = search_goal_space->visited_iteration = iteration_;
+  std::vector<EnvironmentEntry2D*> search_goal_spaces(1, search_goal_space);
+  for (const auto& cell : heuristic_goal_cells_) {
+    if (!IsWithinMapCell(cell.x, cell.y)) continue;
+    EnvironmentEntry2D* space = &grid_[cell.x][cell.y];
+    space->heuristic = INFINITECOST;
+    space->visited_iteration = iteration_;
+    search_goal_spaces.push_back(space);
+  }
 
   // seed the search
   search_exp_space_->heuristic = 0;
@@ -316,7 +356,7 @@ bool Environment::ComputeHeuristicValues() {
   // the main repetition of expansions
   search_exp_space_ = grid_open_.top();
   while (!grid_open_.empty() &&
-         std::min(INFINITECOST, search_goal_space->heuristic) > term_factor * search_exp_space_->heuristic) {
+         std::min(INFINITECOST, LargestHeuristic(search_goal_spaces)) > term_factor * search_exp_space_->heuristic) {
     grid_open_.pop();
 
     int exp_x = search_exp_space_->x;
@@ -455,7 +495,7 @@ void Environment::GetPreds(EnvironmentEntry3D* entry, std::vector<EnvironmentEnt
     cost = ComputeActionCost(pred_x, pred_y, pred_theta, action);
     if (cost >= INFINITECOST) continue;
 
-    pred_entries->push_back(&env_[pred_x][pred_y][pred_theta]);
+    pred_entries->push_back(TouchEnvEntry(pred_x, pred_y, pred_theta));
     costs->push_back(cost);
   }
 }
@@ -496,7 +536,7 @@ void Environment::GetSuccs(EnvironmentEntry3D* entry, std::vector<EnvironmentEnt
     cost = ComputeActionCost(entry->x, entry->y, entry->theta, action);
     if (cost >= INFINITECOST) continue;
 
-    succ_entries->push_back(&env_[new_x][new_y][new_theta]);
+    succ_entries->push_back(TouchEnvEntry(new_x, new_y, new_theta));
     costs->push_back(cost);
     if (actions != NULL) actions->push_back(action);
   }
@@ -0,0 +1,201 @@
+/* Copyright(C) Gaussian Automation. All rights reserved.
+ */
+
+#include "search_based_global_planner/path_annotator.h"
+#include <angles/angles.h>
+#include <tf/transform_datatypes.h>
+#include <algorithm>
+
+namespace search_based_global_planner {
+
+// angle of one in-place rotation primitive, 22p5 digree
+const double ROTATION_STEP = 22.5 * M_PI / 180.0;
+// poses of lattice points are the same on every search, up to rounding
+const double SAME_POINT_EPS = 1e-6;
+
+PathAnnotator::PathAnnotator()
+  : max_vel_(0.6), low_vel_(0.45), min_vel_(0.0), using_short_highlight_(true) { }
+
+PathAnnotator::~PathAnnotator() { }
+
+void PathAnnotator::SetVelocities(double max_vel, double low_vel, double min_vel) {
+  max_vel_ = max_vel;
+  low_vel_ = low_vel;
+  min_vel_ = min_vel;
+  // grades depend on the velocities, annotate everything again
+  if (!points_.empty()) {
+    AnnotateVelocity(0);
+    AnnotateHighlight(0);
+  }
+}
+
+void PathAnnotator::Clear() {
+  points_.clear();
+  raw_infos_.clear();
+  infos_.clear();
+}
+
+void PathAnnotator::Splice(unsigned int begin, const std::vector<XYThetaPoint>& points,
+                           const std::vector<IntermPointStruct>& infos) {
+  begin = std::min(begin, static_cast<unsigned int>(points_.size()));
+  points_.resize(begin);
+  raw_infos_.resize(begin);
+  infos_.resize(begin);
+  points_.insert(points_.end(), points.begin(), points.end());
+  raw_infos_.insert(raw_infos_.end(), infos.begin(), infos.end());
+  infos_.insert(infos_.end(), infos.begin(), infos.end());
+  if (points_.empty()) return;
+
+  // the point before begin leads to a new next point now
+  unsigned int first = begin > 0 ? begin - 1 : 0;
+  for (unsigned int i = first; i < points_.size(); ++i) {
+    double dtheta = 0.0;
+    if (i + 1 < points_.size()) {
+      infos_[i].distance = hypot(points_[i + 1].x - points_[i].x, points_[i + 1].y - points_[i].y);
+      dtheta = fabs(angles::shortest_angular_distance(points_[i].theta, points_[i + 1].theta));
+    } else {
+      infos_[i].distance = 0.0;
+    }
+    // planners that know their radius pass it, the others get it from curvature
+    if (raw_infos_[i].radius > 0.0) {
+      infos_[i].radius = raw_infos_[i].radius;
+    } else if (dtheta < 1e-6) {
+      infos_[i].radius = fixpattern_path::Path::MAX_RADIUS;
+    } else {
+      infos_[i].radius = std::min(infos_[i].distance / dtheta, fixpattern_path::Path::MAX_RADIUS);
+    }
+  }
+
+  // a rotation run going through first is graded again as a whole
+  unsigned int velocity_begin = RotationRunBegin(first);
+  AnnotateVelocity(velocity_begin);
+
+  // highlight of a point looks ahead at most MAX_HIGHLIGHT_DIS
+  unsigned int highlight_begin = velocity_begin;
+  double dis_accu = 0.0;
+  while (highlight_begin > 0 && dis_accu <= MAX_HIGHLIGHT_DIS) {
+    --highlight_begin;
+    dis_accu += infos_[highlight_begin].distance;
+  }
+  AnnotateHighlight(highlight_begin);
+}
+
+unsigned int PathAnnotator::Assign(const std::vector<XYThetaPoint>& points,
+                                   const std::vector<IntermPointStruct>& infos) {
+  // a replan from the same pose keeps the path up to where costs changed
+  unsigned int begin = 0;
+  unsigned int size = std::min(points.size(), points_.size());
+  while (begin < size &&
+         fabs(points[begin].x - points_[begin].x) < SAME_POINT_EPS &&
+         fabs(points[begin].y - points_[begin].y) < SAME_POINT_EPS &&
+         fabs(points[begin].theta - points_[begin].theta) < SAME_POINT_EPS &&
+         infos[begin].is_corner == raw_infos_[begin].is_corner &&
+         infos[begin].rotate_direction == raw_infos_[begin].rotate_direction &&
+         infos[begin].theta_out == raw_infos_[begin].theta_out &&
+         infos[begin].radius == raw_infos_[begin].radius &&
+         infos[begin].max_vel == raw_infos_[begin].max_vel) {
+    ++begin;
+  }
+  if (begin == points.size() && begin == points_.size()) return begin;
+  Splice(begin, std::vector<XYThetaPoint>(points.begin() + begin, points.end()),
+         std::vector<IntermPointStruct>(infos.begin() + begin, infos.end()));
+  return begin;
+}
+
+unsigned int PathAnnotator::RotationRunBegin(unsigned int index) const {
+  if (!raw_infos_[index].is_corner) return index;
+  while (index > 0 && raw_infos_[index - 1].is_corner) --index;
+  return index;
+}
+
+void PathAnnotator::AnnotateVelocity(unsigned int begin) {
+  for (unsigned int i = begin; i < points_.size(); ++i) {
+    if (!raw_infos_[i].is_corner) {
+      infos_[i].is_corner = false;
+      infos_[i].max_vel = raw_infos_[i].max_vel;
+      infos_[i].highlight = MIN_HIGHLIGHT_DIS;
+      continue;
+    }
+
+    // check corner and set max_vel by how far the rotation run turns
+    unsigned int end = i;
+    double angle = 0.0;
+    while (end + 1 < points_.size() && raw_infos_[end + 1].is_corner) {
+      angle += fabs(angles::shortest_angular_distance(points_[end].theta, points_[end + 1].theta));
+      ++end;
+    }
+    angle += fabs(angles::shortest_angular_distance(points_[end].theta, raw_infos_[end].theta_out));
+
+    double max_vel = min_vel_;
+    bool is_corner = false;
+    if (i == 0 || angle > 3.5 * ROTATION_STEP) {  // > 67.5 digree
+      max_vel = min_vel_;
+      is_corner = true;
+    } else if (angle > 1.5 * ROTATION_STEP) {  // 45 and 67.5 digree
+      max_vel = low_vel_;
+    } else {  // 22p5 digree
+      max_vel = max_vel_;
+    }
+    for (unsigned int j = i; j <= end; ++j) {
+      infos_[j].is_corner = is_corner;
+      infos_[j].max_vel = max_vel;
+      infos_[j].highlight = MIN_HIGHLIGHT_DIS;
+    }
+    i = end;
+  }
+}
+
+void PathAnnotator::AnnotateHighlight(unsigned int begin) {
+  // calculate hightlight based on max_vel of each point
+  for (unsigned int i = begin; i < infos_.size(); ++i) {
+    if (infos_[i].max_vel == min_vel_) continue;
+    double sum_highlight = 0.0;
+    for (unsigned int j = i; j < infos_.size(); ++j) {
+      sum_highlight += infos_[j].distance;
+      if (sum_highlight > MAX_HIGHLIGHT_DIS) break;
+      // corner, cut highlight here
+      if (infos_[j].max_vel == min_vel_ || (infos_[j].max_vel == low_vel_ && using_short_highlight_)) break;
+      if (fabs(angles::shortest_angular_distance(points_[i].theta, points_[j].theta)) > M_PI / 2.0) break;
+    }
+    if (sum_highlight > MAX_HIGHLIGHT_DIS) {
+      sum_highlight = MAX_HIGHLIGHT_DIS;
+    } else if (sum_highlight < LOW_HIGHLIGHT_DIS) {
+      sum_highlight = LOW_HIGHLIGHT_DIS;
+    }
+    infos_[i].highlight = sum_highlight;
+  }
+}
+
+void PathAnnotator::GetPathPoints(double offset_x, double offset_y,
+                                  std::vector<fixpattern_path::PathPoint>* path) const {
+  path->clear();
+  path->reserve(points_.size());
+  for (unsigned int i = 0; i < points_.size(); ++i) {
+    geometry_msgs::Pose pose;
+    pose.position.x = points_[i].x + offset_x;
+    pose.position.y = points_[i].y + offset_y;
+    pose.orientation = tf::createQuaternionMsgFromYaw(points_[i].theta);
+    fixpattern_path::PathPoint point = fixpattern_path::GeometryPoseToPathPoint(pose);
+    point.highlight = infos_[i].highlight;
+    point.max_vel = infos_[i].max_vel;
+    point.radius = infos_[i].radius;
+    point.corner_struct.corner_point = false;
+    point.corner_struct.theta_out = 0.0;
+    point.corner_struct.rotate_direction = 0;
+
+    if (infos_[i].is_corner) {
+      // a corner run becomes its first pose, turning to theta_out of its last
+      unsigned int end = i;
+      while (end + 1 < points_.size() && infos_[end + 1].is_corner) ++end;
+      point.corner_struct.corner_point = true;
+      point.corner_struct.theta_out = infos_[end].theta_out;
+      point.corner_struct.rotate_direction = infos_[end].rotate_direction;
+      GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] corner_point index: %d, real theta_out: %lf, dir: %d",
+                    i, infos_[end].theta_out, infos_[end].rotate_direction);
+      i = end;
+    }
+    path->push_back(point);
+  }
+}
+
+};  // namespace search_based_global_planner
@@ -0,0 +1,69 @@
+/* Copyright(C) Gaussian Automation. All rights reserved.
+ */
+
+#include "search_based_global_planner/row_workers.h"
+
+namespace search_based_global_planner {
+
+RowWorkers::RowWorkers(unsigned int num_threads)
+    : num_threads_(num_threads), task_(NULL), num_rows_(0), generation_(0), pending_(0), stop_(false) {
+  if (num_threads_ == 0) num_threads_ = std::thread::hardware_concurrency();
+  if (num_threads_ == 0) num_threads_ = 1;
+  for (unsigned int i = 1; i < num_threads_; ++i) {
+    threads_.push_back(std::thread(&RowWorkers::WorkerLoop, this, i));
+  }
+}
+
+RowWorkers::~RowWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto& t : threads_) t.join();
+}
+
+void RowWorkers::Run(unsigned int num_rows, const RowTask& task) {
+  // not worth waking anyone for a few rows
+  if (threads_.empty() || num_rows < 2 * num_threads_) {
+    task(0, num_rows);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    num_rows_ = num_rows;
+    pending_ = threads_.size();
+    ++generation_;
+  }
+  start_cv_.notify_all();
+
+  // range 0 belongs to the calling thread
+  task(0, num_rows / num_threads_);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+  task_ = NULL;
+}
+
+void RowWorkers::WorkerLoop(unsigned int index) {
+  unsigned int seen_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    start_cv_.wait(lock, [this, seen_generation] { return stop_ || generation_ != seen_generation; });
+    if (stop_) return;
+    seen_generation = generation_;
+    const RowTask* task = task_;
+    unsigned int begin = static_cast<unsigned long long>(num_rows_) * index / num_threads_;
+    unsigned int end = static_cast<unsigned long long>(num_rows_) * (index + 1) / num_threads_;
+    lock.unlock();
+
+    if (begin < end) (*task)(begin, end);
+
+    lock.lock();
+    if (--pending_ == 0) done_cv_.notify_one();
+  }
+}
+
+};  // namespace search_based_global_planner
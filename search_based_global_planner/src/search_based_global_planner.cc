@@ -13,21 +13,19 @@
 #include "search_based_global_planner/utils.h"
 
 #define COMPUTEKEY(entry) (entry)->ComputeKey(eps_, env_->GetHeuristic((entry)->x, (entry)->y))
-#define CHECK_INPLACE_ROTATE(action) (action.action_index == IN_PLACE_ROTATE_LEFT || action.action_index == IN_PLACE_ROTATE_RIGHT)
 #define CHECK_SHORT_FORWARD(action) (action.action_index == SHORT_FORWARD)
 
-const double MAX_HIGHLIGHT_DIS = fixpattern_path::Path::MAX_HIGHLIGHT_DISTANCE * 2.0 / 3.0;
-const double LOW_HIGHLIGHT_DIS = 0.7;
-const double MIN_HIGHLIGHT_DIS = fixpattern_path::Path::MIN_HIGHLIGHT_DISTANCE;
 //const double MAX_VEL = 0.6; 
 //const double LOW_VEL = 0.4; 
 //const double MIN_VEL = 0.0; 
 
 namespace search_based_global_planner {
 
-SearchBasedGlobalPlanner::SearchBasedGlobalPlanner() : initialized_(false) { }
+SearchBasedGlobalPlanner::SearchBasedGlobalPlanner() : workers_(NULL), initialized_(false) { }
 
-SearchBasedGlobalPlanner::~SearchBasedGlobalPlanner() { }
+SearchBasedGlobalPlanner::~SearchBasedGlobalPlanner() {
+  delete workers_;
+}
 
 double GetNumberFromXMLRPC(XmlRpc::XmlRpcValue& value, const std::string& full_param_name) {  // NOLINT
   // Make sure that the value we're looking at is either a double or an int.
@@ -136,6 +134,9 @@ void SearchBasedGlobalPlanner::initialize(std::string name, costmap_2d::Costmap2
     lethal_cost_ = static_cast<unsigned char>(lethal_cost);
     inscribed_inflated_cost_ = lethal_cost_ - 1;
     cost_multiplier_ = static_cast<unsigned char>(costmap_2d::INSCRIBED_INFLATED_OBSTACLE / inscribed_inflated_cost_ + 1);
+    for (int cost = 0; cost < 256; ++cost) {
+      cost_lut_[cost] = TransformCostmapCost(static_cast<unsigned char>(cost));
+    }
     cost_possibly_circumscribed_thresh = TransformCostmapCost(cost_possibly_circumscribed_thresh);
     GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] cost_possibly_circumscribed_thresh: %d", static_cast<int>(cost_possibly_circumscribed_thresh));
 
@@ -149,6 +150,15 @@ void SearchBasedGlobalPlanner::initialize(std::string name, costmap_2d::Costmap2
 
     private_nh.param("p13", map_size_, 400);
     private_nh.param("p15", using_short_highlight_, true);
+    // threads for bulk window population and reset, 0 for hardware concurrency.
+    // Serial by default: reset, cost population and change scan of a 400 window
+    // take about 2.6ms together and were no faster split on one core, check the
+    // UpdateWindowCosts and ReInitializeSearchEnvironment logs before raising it
+    int num_of_workers;
+    private_nh.param("p16", num_of_workers, 1);
+    workers_ = new RowWorkers(std::max(num_of_workers, 0));
+    annotator_.SetVelocities(sbpl_max_vel_, sbpl_low_vel_, sbpl_min_vel_);
+    annotator_.SetUsingShortHighlight(using_short_highlight_);
 		
 
     unsigned int size_x = costmap_->getSizeInCellsX();
@@ -418,8 +428,6 @@ void SearchBasedGlobalPlanner::GetPointPathFromEntryPath(const std::vector<Envir
   std::vector<EnvironmentEntry3D*> succ_entries;
   std::vector<int> costs;
   std::vector<Action*> actions;
-  std::vector<Action> actions_path;
-//  std::vector<Actions_Path> actions_path;
 
   point_path->clear();
   path_info->clear();
@@ -462,117 +470,22 @@ void SearchBasedGlobalPlanner::GetPointPathFromEntryPath(const std::vector<Envir
       interm_point.x += source_x;
       interm_point.y += source_y;
 
-      // store
+      // store, nominal max_vel of forward points, PathAnnotator grades rotation points
+      IntermPointStruct point_info = actions[best_index]->interm_struct[ipind];
+      point_info.max_vel = CHECK_SHORT_FORWARD((*actions[best_index])) ? sbpl_low_vel_ : sbpl_max_vel_;
+      point_info.highlight = MIN_HIGHLIGHT_DIS;
       point_path->push_back(interm_point);
-  //    path_info->push_back(actions[best_index]->interm_struct[ipind]);
+      path_info->push_back(point_info);
 		}
-    actions_path.push_back(*actions.at(best_index));
   }
-//  GAUSSIAN_INFO("[SBPL] actions_path size = %d, point_path size = %d", (int)actions_path.size(), (int)point_path->size());
-  ComputeHighlightAndVelocity(actions_path, point_path, path_info);
 }
 
-void setActionIntermStruct(Action* action, double highlight, double max_vel, bool is_corner) {
-	for (int ipind = 0; ipind < static_cast<int>(action->interm_pts.size()) - 1; ++ipind) {
-		IntermPointStruct point_info = action->interm_struct[ipind];
-		action->interm_struct[ipind].highlight = highlight;
-		action->interm_struct[ipind].max_vel = max_vel;
-		action->interm_struct[ipind].is_corner = is_corner;
-  //  GAUSSIAN_INFO("[SBPL] point[%d]set max_vel = %lf", ipind, max_vel);
-	}
-}	
-
-void SearchBasedGlobalPlanner::ComputeHighlightAndVelocity(const std::vector<Action>& origin_actions_path, 
-                                                         std::vector<XYThetaPoint>* point_path,
-                                                         std::vector<IntermPointStruct>* path_info) {
-  std::vector<Action> actions_path = origin_actions_path;
-//  GAUSSIAN_INFO("[SBPL] 1: actions_path size = %d, path_point size = %d, path_info size = %d", (int)actions_path.size(),(int)point_path->size(), (int)path_info->size());
-  // check corner and set max_vel and highlight of action 
-  for (unsigned int pind = 0; pind < actions_path.size(); ++pind) {
-    unsigned int corner_size = 0;
-		double highlight= MIN_HIGHLIGHT_DIS;
-		double max_vel = sbpl_min_vel_;
-		bool is_corner = false;
-    if (CHECK_INPLACE_ROTATE(actions_path[pind])) {
-      corner_size = 1;
-      for (unsigned int i = pind + 1; i < actions_path.size(); ++i) {
-        if (CHECK_INPLACE_ROTATE(actions_path[i])) {
-          ++corner_size;
-        } else {
-          break;
-        }
-      }
-//      GAUSSIAN_INFO("[SBPL] corner size = %d", corner_size);
-      if(pind == 0 && corner_size >= 1) {
-        max_vel = sbpl_min_vel_;	
-        is_corner = true;
-      } else {	
-        if(corner_size == 1) {  // 22p5 digree
-          max_vel = sbpl_max_vel_;	
-          is_corner = false;
-        } else if(corner_size <= 3) { //45 and 67.5 digree
-          max_vel = sbpl_low_vel_;	
-          is_corner = false;
-        } else if(corner_size > 3) { // > 67.5 digree
-          max_vel = sbpl_min_vel_;	
-          is_corner = true;
-        }
-      }
-      for(unsigned int i = pind; i < pind + corner_size; ++i) {
-        actions_path.at(i).max_vel = max_vel;
-        actions_path.at(i).highlight = highlight;
-        setActionIntermStruct(&actions_path.at(i), highlight, max_vel, is_corner);
-      }
-      pind += corner_size - 1;
-    } else if(CHECK_SHORT_FORWARD(actions_path.at(pind))) {
-      max_vel = sbpl_low_vel_;
-      actions_path.at(pind).max_vel = sbpl_low_vel_;
-      setActionIntermStruct(&actions_path.at(pind), highlight, max_vel, is_corner);
-    } else {
-      max_vel = sbpl_max_vel_;
-      actions_path.at(pind).max_vel = sbpl_max_vel_;
-      setActionIntermStruct(&actions_path.at(pind), highlight, max_vel, is_corner);
-    }
+void SearchBasedGlobalPlanner::ReInitializeSearchEnvironment(bool keep_heuristics) {
+  if (keep_heuristics) {
+    env_->ReInitializeEntries();
+  } else {
+    env_->ReInitialize(workers_);
   }
- 
-	// push action:interm_struct to path_info(including highlight and max_vel) 
-  for (unsigned int pind = 0; pind < actions_path.size(); ++pind) {
-    for (int ipind = 0; ipind < actions_path.at(pind).interm_struct.size() - 1; ++ipind) {
-      path_info->push_back(actions_path.at(pind).interm_struct[ipind]);
-		}
-	}
-	
-	// calculate hightlight based on max_vel of each point in path_info
-	double sum_highlight;
-  for (unsigned int i = 0; i < path_info->size(); ++i) {
-		if (path_info->at(i).max_vel != sbpl_min_vel_) {
-			sum_highlight = 0.0;
-			for (unsigned int j = i; j < path_info->size(); ++j) {
-				sum_highlight += path_info->at(j).distance;
-				if (sum_highlight > MAX_HIGHLIGHT_DIS) {
-					sum_highlight = MAX_HIGHLIGHT_DIS;
-					break;
-				}
-				if (path_info->at(j).max_vel == sbpl_min_vel_ || (path_info->at(j).max_vel == sbpl_low_vel_ && using_short_highlight_)) { //corner, cut highlight here
-					break;
-				}
-        // TODO(lizhen) check break theta
-        if (fabs(angles::shortest_angular_distance(point_path->at(i).theta, point_path->at(j).theta)) > M_PI / 2.0) { //path_info->at(j).max_vel == sbpl_max_vel && 
-          break;
-        }
-			}
-			if (sum_highlight > MAX_HIGHLIGHT_DIS) {
-				sum_highlight = MAX_HIGHLIGHT_DIS;
-			} else if(sum_highlight < LOW_HIGHLIGHT_DIS) {
-				sum_highlight = LOW_HIGHLIGHT_DIS;
-			}
-			path_info->at(i).highlight = sum_highlight;
-		}
-	}	
-}
-
-void SearchBasedGlobalPlanner::ReInitializeSearchEnvironment() {
-  env_->ReInitialize();
 
   open_.clear();
   inconsist_.clear();
@@ -624,6 +537,8 @@ bool SearchBasedGlobalPlanner::search(std::vector<XYThetaPoint>* point_path, std
 
   if (need_to_reinitialize_environment_) {
     ReInitializeSearchEnvironment();
+    GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] ReInitializeSearchEnvironment on %u threads cost %lf seconds",
+                  workers_->NumThreads(), GetTimeInSeconds() - start_time_);
   }
 
   double before_heuristic = GetTimeInSeconds();
@@ -681,6 +596,7 @@ bool SearchBasedGlobalPlanner::CostsChanged(const std::vector<XYCell>& changed_c
 
   EnvironmentEntry3D* entry = NULL;
   std::vector<EnvironmentEntry3D*> affected_entries;
+  unsigned int num_of_affected = 0;
   char* exist = (char*)calloc(map_size_ * map_size_ * size_dir_, sizeof(char));  // NOLINT
   if (!exist) {
     GAUSSIAN_ERROR("[SEARCH BASED GLOBAL PLANNER] allocate memory for exist in CostsChanged failed");
@@ -696,12 +612,17 @@ bool SearchBasedGlobalPlanner::CostsChanged(const std::vector<XYCell>& changed_c
       affected_cell.x = affected_cell.x + cell.x;
       affected_cell.y = affected_cell.y + cell.y;
 
-      entry = env_->GetEnvEntry(affected_cell.x, affected_cell.y, affected_cell.theta);
-      if (!entry) continue;
+      if (affected_cell.x < 0 || affected_cell.y < 0 ||
+          affected_cell.x >= map_size_ || affected_cell.y >= map_size_) continue;
 
       int index = affected_cell.theta + affected_cell.x * size_dir_ + affected_cell.y * map_size_ * size_dir_;
       if (exist[index] == 1) continue;
       exist[index] = 1;
+      ++num_of_affected;
+
+      // untouched entries are not visited in this search, no need to materialize them
+      entry = env_->FindEnvEntry(affected_cell.x, affected_cell.y, affected_cell.theta);
+      if (!entry) continue;
 
       // insert to affected_entries
       affected_entries.push_back(entry);
@@ -709,13 +630,13 @@ bool SearchBasedGlobalPlanner::CostsChanged(const std::vector<XYCell>& changed_c
   }
   // don't forget to free exist
   free(exist);
-  GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] CostsChanged cost %lf seconds, changed_cells.size() %d, affected_entries.size() %d",
-           GetTimeInSeconds() - start_time, (int)changed_cells.size(), (int)affected_entries.size());
+  GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] CostsChanged cost %lf seconds, changed_cells.size() %d, affected %d, affected_entries.size() %d",
+           GetTimeInSeconds() - start_time, (int)changed_cells.size(), (int)num_of_affected, (int)affected_entries.size());
 
-  if (affected_entries.size() <= 0) return true;
+  if (num_of_affected <= 0) return true;
 
   // update preds of changed edges
-  if (affected_entries.size() > map_size_ * map_size_ * size_dir_ / 10 || affected_entries.size() > force_scratch_limit_) {
+  if (num_of_affected > map_size_ * map_size_ * size_dir_ / 10 || num_of_affected > force_scratch_limit_) {
     need_to_reinitialize_environment_ = true;
   }
 
@@ -745,6 +666,110 @@ unsigned char SearchBasedGlobalPlanner::TransformCostmapCost(unsigned char cost)
   }
 }
 
+void SearchBasedGlobalPlanner::UpdateWindowCosts(unsigned int start_cell_x, unsigned int start_cell_y,
+                                                 std::vector<XYCell>* changed_cells) {
+  // transform whole costmap rows through cost_lut_, rows are contiguous in the costmap
+  const unsigned char* char_map = costmap_->getCharMap();
+  window_costs_.resize(map_size_ * map_size_);
+  workers_->Run(map_size_, [&](unsigned int begin_y, unsigned int end_y) {
+    for (unsigned int iy = begin_y; iy < end_y; ++iy) {
+      const unsigned char* costmap_row = char_map + costmap_->getIndex(start_cell_x, iy + start_cell_y);
+      unsigned char* window_row = &window_costs_[iy * map_size_];
+      for (unsigned int ix = 0; ix < map_size_; ++ix) {
+        window_row[ix] = cost_lut_[costmap_row[ix]];
+      }
+    }
+  });
+
+  // find changed cells of each x in parallel, only reading env_
+  changed_columns_.resize(map_size_);
+  workers_->Run(map_size_, [&](unsigned int begin_x, unsigned int end_x) {
+    for (unsigned int ix = begin_x; ix < end_x; ++ix) {
+      changed_columns_[ix].clear();
+      for (unsigned int iy = 0; iy < map_size_; ++iy) {
+        if (env_->GetCost(ix, iy) != window_costs_[iy * map_size_ + ix]) {
+          changed_columns_[ix].push_back(XYCell(ix, iy));
+        }
+      }
+    }
+  });
+
+  // then update them in the same order as a serial scan
+  for (unsigned int ix = 0; ix < map_size_; ++ix) {
+    for (const auto& cell : changed_columns_[ix]) {
+      env_->UpdateCost(cell.x, cell.y, window_costs_[cell.y * map_size_ + cell.x]);
+      changed_cells->push_back(cell);
+    }
+  }
+}
+
+bool SearchBasedGlobalPlanner::GetWindowOrigin(const geometry_msgs::PoseStamped& start,
+                                               unsigned int* start_cell_x, unsigned int* start_cell_y,
+                                               double* start_x, double* start_y) {
+  unsigned int cell_x, cell_y;
+  if (!costmap_->worldToMap(start.pose.position.x,
+                            start.pose.position.y, cell_x, cell_y)) {
+    GAUSSIAN_ERROR("[SBPL LATTICE PLANNER]start_point: world to map failed");
+    return false;
+  }
+
+  // get lower left point of sbpl map
+  *start_cell_x = 0;
+  *start_cell_y = 0;
+  if (cell_x > map_size_ / 2 && cell_x <= costmap_->getSizeInCellsX() - map_size_ / 2) {
+    *start_cell_x = cell_x - map_size_ / 2;
+  } else if (cell_x > costmap_->getSizeInCellsX() - map_size_ / 2) {
+    *start_cell_x = costmap_->getSizeInCellsX() - map_size_;
+  }
+  if (cell_y > map_size_ / 2 && cell_y <= costmap_->getSizeInCellsY() - map_size_ / 2) {
+    *start_cell_y = cell_y - map_size_ / 2;
+  } else if (cell_y > costmap_->getSizeInCellsY() - map_size_ / 2) {
+    *start_cell_y = costmap_->getSizeInCellsY() - map_size_;
+  }
+
+  costmap_->mapToWorld(*start_cell_x, *start_cell_y, *start_x, *start_y);
+  *start_x -= resolution_ / 2.0;
+  *start_y -= resolution_ / 2.0;
+  return true;
+}
+
+void SearchBasedGlobalPlanner::FillPlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
+                                        double start_x, double start_y, std::vector<XYThetaPoint>* point_path,
+                                        std::vector<geometry_msgs::PoseStamped>* plan) {
+  ros::Time plan_time = ros::Time::now();
+  for (unsigned int i = 0; i < point_path->size(); ++i) {
+    geometry_msgs::PoseStamped pose;
+    pose.header.stamp = plan_time;
+    pose.header.frame_id = costmap_ros_->getGlobalFrameID();
+
+    point_path->at(i).x += start_x;
+    point_path->at(i).y += start_y;
+    pose.pose.position.x = point_path->at(i).x;
+    pose.pose.position.y = point_path->at(i).y;
+    pose.pose.position.z = start.pose.position.z;
+
+    tf::Quaternion temp;
+    temp.setRPY(0, 0, point_path->at(i).theta);
+    pose.pose.orientation.x = temp.getX();
+    pose.pose.orientation.y = temp.getY();
+    pose.pose.orientation.z = temp.getZ();
+    pose.pose.orientation.w = temp.getW();
+
+    plan->push_back(pose);
+  }
+  plan->push_back(goal);
+}
+
+fixpattern_path::PathPoint SearchBasedGlobalPlanner::GoalPathPoint(const geometry_msgs::PoseStamped& goal) {
+  fixpattern_path::PathPoint point = fixpattern_path::GeometryPoseToPathPoint(goal.pose);
+  point.highlight = MIN_HIGHLIGHT_DIS;
+  point.max_vel = 0.0;
+  point.radius = 0.5;
+  point.corner_struct.corner_point = false;
+  point.corner_struct.theta_out = 0.0;
+  return point;
+}
+
 bool SearchBasedGlobalPlanner::makePlan(geometry_msgs::PoseStamped start,
                                         geometry_msgs::PoseStamped goal,
                                         std::vector<geometry_msgs::PoseStamped>& plan,
@@ -771,31 +796,10 @@ bool SearchBasedGlobalPlanner::makePlan(geometry_msgs::PoseStamped start,
   // costmap_ros_->getRobotPose(global_pose);
   // geometry_msgs::PoseStamped tmp_pos;
   // tf::poseStampedTFToMsg(global_pose, tmp_pos);
-  unsigned int cell_x, cell_y;
-  if (!costmap_->worldToMap(start.pose.position.x,
-                            start.pose.position.y, cell_x, cell_y)) {
-    GAUSSIAN_ERROR("[SBPL LATTICE PLANNER]start_point: world to map failed");
-    return false;
-  }
-
-  // get lower left point of sbpl map
-  unsigned int start_cell_x = 0;
-  unsigned int start_cell_y = 0;
-  if (cell_x > map_size_ / 2 && cell_x <= costmap_->getSizeInCellsX() - map_size_ / 2) {
-    start_cell_x = cell_x - map_size_ / 2;
-  } else if (cell_x > costmap_->getSizeInCellsX() - map_size_ / 2) {
-    start_cell_x = costmap_->getSizeInCellsX() - map_size_;
-  }
-  if (cell_y > map_size_ / 2 && cell_y <= costmap_->getSizeInCellsY() - map_size_ / 2) {
-    start_cell_y = cell_y - map_size_ / 2;
-  } else if (cell_y > costmap_->getSizeInCellsY() - map_size_ / 2) {
-    start_cell_y = costmap_->getSizeInCellsY() - map_size_;
-  }
-
+  unsigned int start_cell_x, start_cell_y;
   double start_x, start_y;
-  costmap_->mapToWorld(start_cell_x, start_cell_y, start_x, start_y);
-  start_x -= resolution_ / 2.0;
-  start_y -= resolution_ / 2.0;
+  if (!GetWindowOrigin(start, &start_cell_x, &start_cell_y, &start_x, &start_y))
+    return false;
 
   // set start and goal point, we have to set goal first in case computing
   // heuristic values when set start
@@ -826,20 +830,10 @@ bool SearchBasedGlobalPlanner::makePlan(geometry_msgs::PoseStamped start,
 
   // update costs that are changed
   std::vector<XYCell> changed_cells;
-
-  for (unsigned int ix = 0; ix < map_size_; ++ix) {
-    for (unsigned int iy = 0; iy < map_size_; ++iy) {
-      unsigned char old_cost = env_->GetCost(ix, iy);
-      unsigned char new_cost = TransformCostmapCost(costmap_->getCost(ix + start_cell_x, iy + start_cell_y));
-
-      if (old_cost == new_cost) continue;
-
-      env_->UpdateCost(ix, iy, new_cost);
-
-      XYCell cell(ix, iy);
-      changed_cells.push_back(cell);
-    }
-  }
+  double before_window_costs = GetTimeInSeconds();
+  UpdateWindowCosts(start_cell_x, start_cell_y, &changed_cells);
+  GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] UpdateWindowCosts on %u threads cost %lf seconds",
+                workers_->NumThreads(), GetTimeInSeconds() - before_window_costs);
 
   double before_costs_changed = GetTimeInSeconds();
   if (!changed_cells.empty())
@@ -856,87 +850,19 @@ bool SearchBasedGlobalPlanner::makePlan(geometry_msgs::PoseStamped start,
     return false;
 
   // fill plan
-  ros::Time plan_time = ros::Time::now();
-  for (unsigned int i = 0; i < point_path.size(); ++i) {
-    geometry_msgs::PoseStamped pose;
-    pose.header.stamp = plan_time;
-    pose.header.frame_id = costmap_ros_->getGlobalFrameID();
-
-    pose.pose.position.x = point_path[i].x + start_x;
-    pose.pose.position.y = point_path[i].y + start_y;
-    pose.pose.position.z = start.pose.position.z;
-
-    tf::Quaternion temp;
-    temp.setRPY(0, 0, point_path[i].theta);
-    pose.pose.orientation.x = temp.getX();
-    pose.pose.orientation.y = temp.getY();
-    pose.pose.orientation.z = temp.getZ();
-    pose.pose.orientation.w = temp.getW();
-
-    plan.push_back(pose);
-  }
-  plan.push_back(goal);
+  FillPlan(start, goal, start_x, start_y, &point_path, &plan);
 
   // publish the plan
   PublishPlan(plan);
 
-  // assign to fixpattern_path::Path
+  // assign to fixpattern_path::Path, a replan from the same pose only annotates from where it changed
+  unsigned int annotate_begin = annotator_.Assign(point_path, path_info);
+  GAUSSIAN_INFO("[SBPL] annotated %d of %d points", (int)(point_path.size() - annotate_begin), (int)point_path.size());
   std::vector<fixpattern_path::PathPoint> tmp_path;
-  for (unsigned int i = 0; i < plan.size() - 1; ++i) {
-    //GAUSSIAN_INFO("[SBPL] path_info[%d]", i);
-    if (path_info[i].is_corner) {
-      unsigned int corner_size = 1;
-      for (unsigned int j = i + 1; j < plan.size() - 1; ++j) {
-        if (path_info[j].is_corner)
-          corner_size++;
-        else
-          break;
-      }
-      unsigned int corner_end_index = i + (corner_size - 1);
-      if(i == 0 || corner_size >= 18) {  // >67.5
-        fixpattern_path::PathPoint point = fixpattern_path::GeometryPoseToPathPoint(plan[i].pose);
-        point.highlight = path_info[i].highlight;
-        point.max_vel = path_info[i].max_vel;
-        point.radius = path_info[i].radius;
-        point.corner_struct.corner_point = true;
-        point.corner_struct.theta_out = path_info[corner_end_index].theta_out;
-        point.corner_struct.rotate_direction = path_info[corner_end_index].rotate_direction;
-        tmp_path.push_back(point);
-        GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] corner_point index: %d, real theta_out: %lf, dir: %d", i, path_info[corner_end_index].theta_out, path_info[corner_end_index].rotate_direction);
-/*    for (unsigned int j = i; j <= corner_end_index; ++j) {
-        fixpattern_path::PathPoint point = fixpattern_path::GeometryPoseToPathPoint(plan[j].pose);
-        point.highlight = path_info[i].highlight;
-        point.max_vel = path_info[i].max_vel;
-        point.radius = path_info[j].radius;
-        point.corner_struct.corner_point = true;
-        point.corner_struct.theta_out = path_info[corner_end_index].theta_out;
-        point.corner_struct.rotate_direction = path_info[corner_end_index].rotate_direction;
-        tmp_path.push_back(point);
-        GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] corner_point index: %d, size: %d, real theta_out: %lf, dir: %d", j, (int)path_info.size(), path_info[j].theta_out, path_info[j].rotate_direction);
-      }
-*/
-      }
-      i = corner_end_index;
-    } else {
-      fixpattern_path::PathPoint point = fixpattern_path::GeometryPoseToPathPoint(plan[i].pose);
-      point.highlight = path_info[i].highlight;
-      point.max_vel = path_info[i].max_vel;
-      point.radius = path_info[i].radius;
-      point.corner_struct.corner_point = false;
-      point.corner_struct.theta_out = 0.0;
-      point.corner_struct.rotate_direction = 0;
-      tmp_path.push_back(point);
-    }
-  }
+  annotator_.GetPathPoints(0.0, 0.0, &tmp_path);
 
   // if (!broader_start_and_goal_) {
-    fixpattern_path::PathPoint point = fixpattern_path::GeometryPoseToPathPoint(plan.back().pose);
-    point.highlight = MIN_HIGHLIGHT_DIS;
-    point.max_vel = 0.0;
-    point.radius = 0.5;
-    point.corner_struct.corner_point = false;
-    point.corner_struct.theta_out = 0.0;
-    tmp_path.push_back(point);
+    tmp_path.push_back(GoalPathPoint(plan.back()));
   // }
 	
   int corner_size = 0;
@@ -990,4 +916,94 @@ bool SearchBasedGlobalPlanner::makePlan(geometry_msgs::PoseStamped start,
   return true;
 }
 
+int SearchBasedGlobalPlanner::makePlans(const geometry_msgs::PoseStamped& start,
+                                        const std::vector<geometry_msgs::PoseStamped>& goals,
+                                        std::vector<std::vector<geometry_msgs::PoseStamped> >* plans,
+                                        std::vector<fixpattern_path::Path>* paths, bool broader_start_and_goal) {
+  if (!initialized_) {
+    GAUSSIAN_ERROR("[SEARCH BASED GLOBAL PLANNER] SearchBasedGlobalPlanner is not initialized");
+    return 0;
+  }
+
+  plans->assign(goals.size(), std::vector<geometry_msgs::PoseStamped>());
+  paths->assign(goals.size(), fixpattern_path::Path());
+  if (goals.empty()) return 0;
+
+  broader_start_and_goal_ = broader_start_and_goal;
+
+  unsigned int start_cell_x, start_cell_y;
+  double start_x, start_y;
+  if (!GetWindowOrigin(start, &start_cell_x, &start_cell_y, &start_x, &start_y))
+    return 0;
+
+  // one snapshot of costs for all goals, lattice is searched from scratch for each goal anyway
+  std::vector<XYCell> changed_cells;
+  UpdateWindowCosts(start_cell_x, start_cell_y, &changed_cells);
+
+  // heuristics from start are computed once, covering all goals
+  std::vector<XYCell> goal_cells;
+  for (const auto& goal : goals) {
+    goal_cells.push_back(XYCell(CONTXY2DISC(goal.pose.position.x - start_x, resolution_),
+                                CONTXY2DISC(goal.pose.position.y - start_y, resolution_)));
+  }
+  env_->SetHeuristicGoals(goal_cells);
+
+  double theta_start = 2 * atan2(start.pose.orientation.z, start.pose.orientation.w);
+  int num_of_plans = 0;
+  // goals share allocated_time_, a batch blocks no longer than one makePlan
+  double batch_start_time = GetTimeInSeconds();
+  for (unsigned int i = 0; i < goals.size(); ++i) {
+    if (GetTimeInSeconds() - batch_start_time >= allocated_time_) {
+      GAUSSIAN_WARN("[SEARCH BASED GLOBAL PLANNER] makePlans: out of time, skip goals from %d on", (int)i);
+      break;
+    }
+    double theta_goal = 2 * atan2(goals[i].pose.orientation.z, goals[i].pose.orientation.w);
+    goal_entry_ = env_->SetGoal(goals[i].pose.position.x - start_x,
+                                goals[i].pose.position.y - start_y, theta_goal);
+    start_entry_ = env_->SetStart(start.pose.position.x - start_x,
+                                  start.pose.position.y - start_y, theta_start);
+    if (!start_entry_ || !goal_entry_) continue;
+
+    // a fresh search for each goal, so its plan doesn't depend on the other goals
+    ReInitializeSearchEnvironment(true);
+    env_->EnsureHeuristicsUpdated();
+    iteration_++;
+    for (auto it = open_.begin(); it != open_.end(); ++it)
+      COMPUTEKEY(*it);
+    open_.make_heap();
+
+    // only the first solution at initial_epsilon_, improving it depends on timing
+    start_time_ = batch_start_time;
+    if (!ComputeOrImprovePath()) {
+      GAUSSIAN_ERROR("[SEARCH BASED GLOBAL PLANNER] makePlans: cannot find a solution to goal %d", (int)i);
+      continue;
+    }
+    std::vector<EnvironmentEntry3D*> entry_path;
+    std::vector<XYThetaPoint> point_path;
+    std::vector<IntermPointStruct> path_info;
+    GetEntryPath(&entry_path);
+    GetPointPathFromEntryPath(entry_path, &point_path, &path_info);
+    if (point_path.size() == 0) continue;
+
+    FillPlan(start, goals[i], start_x, start_y, &point_path, &plans->at(i));
+
+    // annotator_ keeps the last plan of makePlan for the next one to splice, leave it alone
+    PathAnnotator annotator;
+    annotator.SetVelocities(sbpl_max_vel_, sbpl_low_vel_, sbpl_min_vel_);
+    annotator.SetUsingShortHighlight(using_short_highlight_);
+    annotator.Append(point_path, path_info);
+    std::vector<fixpattern_path::PathPoint> tmp_path;
+    annotator.GetPathPoints(0.0, 0.0, &tmp_path);
+    tmp_path.push_back(GoalPathPoint(goals[i]));
+    paths->at(i).set_sbpl_path(start, tmp_path, false);
+    ++num_of_plans;
+  }
+  GAUSSIAN_INFO("[SEARCH BASED GLOBAL PLANNER] makePlans found %d plans to %d goals", num_of_plans, (int)goals.size());
+
+  // lattice is left with the last goal, next makePlan has to start over
+  env_->SetHeuristicGoals(std::vector<XYCell>());
+  need_to_reinitialize_environment_ = true;
+  return num_of_plans;
+}
+
 };  // namespace search_based_global_planner
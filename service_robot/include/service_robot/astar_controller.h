@@ -32,7 +32,11 @@
 #include <fixpattern_path/path.h>
 #include <search_based_global_planner/search_based_global_planner.h>
 #include <fixpattern_local_planner/trajectory_planner_ros.h>
+#include <std_msgs/Float64.h>
 #include <gslib/gaussian_debug.h>
+#include <stdint.h>
+#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -86,6 +90,74 @@ typedef enum {
   CHARGING 
 } MovebaseGoalTypeIndex;
 
+/**
+ * @brief cached result of a costmap safety check, only reused while both the
+ *        costmap revision and the quantized query key are unchanged
+ */
+struct SafetyCheckMemo {
+  bool valid;
+  unsigned int revision;
+  uint64_t key;
+  double result;
+  int obstacle_index;  // -1 if the check didn't touch obstacle_index_
+  unsigned int front_goal_index;
+
+  SafetyCheckMemo()
+    : valid(false), revision(0), key(0), result(0.0),
+      obstacle_index(-1), front_goal_index(0) { }
+};
+
+/**
+ * @brief latest protector status polled from device, stamp is 0.0 until the
+ *        first successful poll, available is false until the service shows up
+ */
+struct ProtectorState {
+  bool available;
+  bool protect_status;
+  unsigned int protect_value;
+  double stamp;
+
+  ProtectorState() : available(false), protect_status(false), protect_value(0), stamp(0.0) { }
+};
+
+/**
+ * @brief protector status cache shared with the polling thread, the thread holds
+ *        its own reference so it can be left behind if a service call hangs
+ */
+struct ProtectorPoller {
+  boost::mutex mutex;
+  ProtectorState state;
+  ros::ServiceClient client;
+};
+
+/**
+ * @brief decisions and timings of one control cycle, recorded for offline
+ *        regression of controller behavior and cycle cost
+ */
+struct CycleRecord {
+  double stamp;  // ros time, the bag clock when replayed with use_sim_time
+  double cycle_time;
+  double costmap_time;
+  double switch_time;
+  double prune_time;
+  double front_check_time;
+  double local_planner_time;
+  AStarState state_before;
+  AStarState state;
+  AStarRecoveryTrigger recovery_trigger;
+  AStarPlanningState planning_state;
+  geometry_msgs::PoseStamped pose;
+  geometry_msgs::PoseStamped goal;
+  geometry_msgs::Twist cmd_vel;  // published by local planner this cycle, zero if none
+  unsigned int costmap_revision;
+  bool done;
+
+  CycleRecord()
+    : stamp(0.0), cycle_time(0.0), costmap_time(0.0), switch_time(0.0), prune_time(0.0),
+      front_check_time(0.0), local_planner_time(0.0), state_before(A_PLANNING), state(A_PLANNING),
+      recovery_trigger(A_PLANNING_R), planning_state(P_INSERTING_NONE), costmap_revision(0), done(false) { }
+};
+
 struct AStarControlOption : BaseControlOption {
   double stop_duration;
   double localization_duration;
@@ -112,6 +184,8 @@ struct AStarControlOption : BaseControlOption {
   double init_path_circle_center_extend_y;
   double recovery_footprint_extend_x;
   double recovery_footprint_extend_y;
+  // csv file to record every control cycle in, empty for no recording
+  std::string cycle_record_file;
 
   int* fixpattern_reached_goal;
   fixpattern_path::Path* fixpattern_path;
@@ -128,12 +202,13 @@ struct AStarControlOption : BaseControlOption {
   boost::shared_ptr<fixpattern_local_planner::FixPatternTrajectoryPlannerROS> fixpattern_local_planner;
 
   AStarControlOption(tf::TransformListener* tf,
+                     costmap_2d::Costmap2DROS* planner_costmap_ros,
                      costmap_2d::Costmap2DROS* controller_costmap_ros,
                      const std::string& robot_base_frame, const std::string& global_frame,
                      double planner_frequency, double controller_frequency, double inscribed_radius,
                      double planner_patience, double controller_patience, double oscillation_timeout,
                      double oscillation_distance, ros::Publisher* vel_pub)
-    : BaseControlOption(tf, controller_costmap_ros, controller_costmap_ros,
+    : BaseControlOption(tf, planner_costmap_ros, controller_costmap_ros,
                         robot_base_frame, global_frame,
                         planner_frequency, controller_frequency, inscribed_radius,
                         planner_patience, controller_patience, oscillation_timeout,
@@ -147,9 +222,10 @@ class AStarController : public BaseController {
    *
    * @param tf A pointer to a TransformListener
    * @param planner_costmap_ros A pointer to a Costmap2DROS of global frame
-   * @param controller_costmap_ros A pointer to a Costmap2DROS of local frame
+   * @param controller_costmap_ros A pointer to a Costmap2DROS of local frame, may be the same as planner_costmap_ros
    */
   AStarController(tf::TransformListener* tf,
+                  costmap_2d::Costmap2DROS* planner_costmap_ros,
                   costmap_2d::Costmap2DROS* controller_costmap_ros);
   /**
    * @brief  Destructor - Cleans up
@@ -169,11 +245,20 @@ class AStarController : public BaseController {
   bool ExecuteCycle();
   /**
    * @brief  Make a new global plan
-   * @param  goal The goal to plan to
+   * @param  goal The goal to plan to, moved along fixpattern_path if a middle path
+   *         only reaches a further goal
    * @param  plan Will be filled in with the plan made by the planner
    * @return  True if planning succeeds, false otherwise
    */
-  bool MakePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>* plan);
+  bool MakePlan(const geometry_msgs::PoseStamped& start, geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>* plan);
+  /**
+   * @brief  Batch plan with sbpl to safe goals further along fixpattern_path than goal
+   * @param  goal Goal sbpl failed to reach, replaced by the nearest further goal reached
+   * @param  plan Will be filled in with the plan to that goal, astar_path_ is set too
+   * @return  True if any further goal is reached
+   */
+  bool MakeSbplPlanToFurtherGoal(const geometry_msgs::PoseStamped& start, geometry_msgs::PoseStamped& goal,
+                                 std::vector<geometry_msgs::PoseStamped>* plan);
   /**
    * @brief  Publishes a velocity command of zero to the base
    */
@@ -204,11 +289,11 @@ class AStarController : public BaseController {
   bool IsGoalUnreachable(const geometry_msgs::PoseStamped& goal_pose);
   bool IsFixPathFrontSafe(double front_safe_check_dis);
   bool IsPathFootprintSafe(const fixpattern_path::Path& fix_path, double length);
-  bool IsPathFootprintSafe(const std::vector<geometry_msgs::PoseStamped>& path,
+  bool IsPathFootprintSafe(const std::vector<fixpattern_path::PathPoint>& path,
                            const std::vector<geometry_msgs::Point>& circle_center_points, double length);
   bool IsGlobalGoalReached(const geometry_msgs::PoseStamped& current_position, const geometry_msgs::PoseStamped& global_goal,
                             double xy_goal_tolerance, double yaw_goal_tolerance);
-  double CheckFixPathFrontSafe(const std::vector<geometry_msgs::PoseStamped>& path, double front_safe_check_dis, double extend_x, double extend_y, int begin_index = 0);
+  double CheckFixPathFrontSafe(const std::vector<fixpattern_path::PathPoint>& path, double front_safe_check_dis, double extend_x, double extend_y, int begin_index = 0);
   bool RecheckFixPath(const geometry_msgs::PoseStamped& global_start, bool using_static_costmap);
   bool NeedBackward(const geometry_msgs::PoseStamped& pose, double distance);
   void SampleInitialPath(std::vector<geometry_msgs::PoseStamped>* planner_plan,
@@ -222,7 +307,24 @@ class AStarController : public BaseController {
   bool HandleGoingBack(geometry_msgs::PoseStamped& current_position, double backward_dis = 0.0);
   bool HeadingChargingGoal(const geometry_msgs::PoseStamped& charging_goal);
   bool HandleSwitchingPath(geometry_msgs::PoseStamped current_position, bool switch_directly = false);
+  /**
+   * @brief Precompute points and accumulated distance of front_path_, called on
+   *        planner thread when front_path_ is set, so HandleSwitchingPath only advances switch_cursor_.
+   *        Caller holds planner_mutex_, which guards front_path_, switch points and switch_cursor_
+   */
+  void PrepareSwitchingPath();
+  /**
+   * @brief Get points of front_path_ from switch_cursor_ on, which is the path to switch to
+   */
+  std::vector<fixpattern_path::PathPoint> SwitchingPathPoints();
+  bool IsPoseOnSwitchingPath(const geometry_msgs::PoseStamped& pose, double dis_diff, double yaw_diff);
   void PlanThread();
+  /**
+   * @brief Append cycle_record_ of the finished cycle to co_->cycle_record_file
+   * @param done Return value of ExecuteCycle
+   * @param cycle_time Wall time the cycle took
+   */
+  void RecordCycle(bool done, double cycle_time);
   double PoseStampedDistance(const geometry_msgs::PoseStamped& p1, const geometry_msgs::PoseStamped& p2);
 
   void PublishPlan(const ros::Publisher& pub, const std::vector<geometry_msgs::PoseStamped>& plan);
@@ -247,12 +349,56 @@ class AStarController : public BaseController {
 
   void LocalizationCallBack(const std_msgs::Int8::ConstPtr& param);
   bool CheckGoalIsSafe(autoscrubber_services::CheckGoal::Request& req, autoscrubber_services::CheckGoal::Response& res); // NOLINT
+  /**
+   * @brief Check cached protector status, stale status is not regarded as detected,
+   *        callers check IsProtectorStatusStale first
+   * @param current_position Current pose, used when going back
+   * @param detect_front_protector Whether going back if front protector detected
+   * @return True if protector detected
+   */
   bool CheckProtector(geometry_msgs::PoseStamped& current_position, bool detect_front_protector = true);
+  /**
+   * @brief Poll protector status from device and cache it, so control cycle never waits on the service
+   */
+  static void ProtectorThread(boost::shared_ptr<ProtectorPoller> poller);
+  /**
+   * @brief True if protector service exists but hasn't answered within timeout,
+   *        always false on robots without protector service
+   */
+  bool IsProtectorStatusStale();
+  /**
+   * @brief Bump costmap_revision_ after planner costmap content changed, memoized safety checks become stale
+   */
+  void BumpCostmapRevision();
+  /**
+   * @brief Get memoized result of a safety check
+   * @param memo Memo slot of the check
+   * @param key Hash of the quantized query
+   * @param revision Costmap revision the query runs against
+   * @param hit Will be filled with the cached entry
+   * @return True if cached entry is still valid
+   */
+  bool LookupSafetyMemo(const SafetyCheckMemo& memo, uint64_t key, unsigned int revision, SafetyCheckMemo* hit);
+  void StoreSafetyMemo(SafetyCheckMemo* memo, const SafetyCheckMemo& value);
+  /**
+   * @brief Hand fixpattern_path to local planner, sharing local_plan_path_ with an
+   *        offset while fixpattern_path is only pruned
+   * @return False if local planner rejects the plan
+   */
+  bool SetLocalPlannerPlan();
+  /**
+   * @brief Get current costmap revision, it's bumped first if controller costmap content changed
+   */
+  unsigned int CostmapRevision();
 
  private:
   tf::TransformListener& tf_;
 
+  // planner costmap is used by global planners and static costmap checks,
+  // controller costmap by safety checks of every control cycle
+  costmap_2d::Costmap2DROS* planner_costmap_ros_;
   costmap_2d::Costmap2DROS* controller_costmap_ros_;
+  const costmap_2d::Costmap2D* controller_costmap_;
 
   tf::Stamped<tf::Pose> global_pose_;
 
@@ -268,6 +414,24 @@ class AStarController : public BaseController {
   fixpattern_path::Path astar_path_;
   // used for path switching and replacing
   fixpattern_path::Path front_path_;
+  // precomputed from front_path_ by PrepareSwitchingPath, switch_cursor_
+  // is the closest point to robot, instead of pruning front_path_. Guarded by planner_mutex_
+  std::vector<fixpattern_path::PathPoint> switch_points_;
+  std::vector<double> switch_accu_dis_;
+  unsigned int switch_cursor_;
+  // robot pose and goal of the bezier splice in front_path_, HandleSwitchingPath
+  // only splices again once either moves
+  bool bezier_spliced_;
+  fixpattern_path::PathPoint bezier_splice_start_;
+  fixpattern_path::PathPoint bezier_splice_goal_;
+  // fixpattern_path as last handed to local planner, copied again only once
+  // fix_path_replaced_ is set by whoever replaces fixpattern_path
+  std::shared_ptr<const std::vector<fixpattern_path::PathPoint> > local_plan_path_;
+  bool fix_path_replaced_;
+  // fixpattern_path as replaced by planner thread and its velocity profile, computed
+  // there instead of in control cycle, SetLocalPlannerPlan takes them. Guarded by planner_mutex_
+  std::shared_ptr<const std::vector<fixpattern_path::PathPoint> > planned_path_;
+  std::shared_ptr<const fixpattern_local_planner::VelocityProfile> planned_profile_;
   // footprint checker
   service_robot::FootprintChecker* footprint_checker_;
 
@@ -341,13 +505,33 @@ class AStarController : public BaseController {
   ros::Publisher sbpl_goal_pub_;
   ros::Publisher astar_extend_pose_pub_;
   ros::Publisher move_base_status_pub_;
+  ros::Publisher planner_costmap_latency_pub_;
+  ros::Publisher controller_costmap_latency_pub_;
   ros::Subscriber set_init_sub_;
   ros::Subscriber localization_sub_;
   ros::ServiceServer check_goal_srv_;
   ros::ServiceClient start_rotate_client_;
   ros::ServiceClient stop_rotate_client_;
   ros::ServiceClient check_rotate_client_;
-  ros::ServiceClient check_protector_client_;
+
+  // record of current control cycle
+  CycleRecord cycle_record_;
+  std::ofstream cycle_record_stream_;
+
+  // protector status cache, updated by protector_thread_
+  boost::shared_ptr<ProtectorPoller> protector_poller_;
+  boost::thread* protector_thread_;
+
+  // costmap revision, bumped whenever costmap content changes, used to skip
+  // redundant safety rechecks within a revision
+  unsigned int costmap_revision_;
+  uint64_t controller_costmap_fingerprint_;
+  uint64_t planner_costmap_fingerprint_;
+  boost::mutex safety_memo_mutex_;
+  SafetyCheckMemo goal_safe_memo_;
+  SafetyCheckMemo front_safe_memo_;
+  SafetyCheckMemo path_safe_memo_;
+  SafetyCheckMemo need_backward_memo_;
 };
 
 };  // namespace service_robot
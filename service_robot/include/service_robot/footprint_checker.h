@@ -33,9 +33,10 @@ class FootprintChecker {
   /**
    * @brief  Constructor for the FootprintChecker
    * @param costmap The costmap that should be used
+   * @param planner_costmap The costmap looked up where costmap doesn't cover, e.g. costmap is a rolling window
    * @return
    */
-  explicit FootprintChecker(const costmap_2d::Costmap2D* costmap);
+  explicit FootprintChecker(const costmap_2d::Costmap2D* costmap, const costmap_2d::Costmap2D* planner_costmap = NULL);
 
   /**
    * @brief  Destructor for the world model
@@ -43,6 +44,7 @@ class FootprintChecker {
   virtual ~FootprintChecker() { }
 
   void setStaticCostmap(costmap_2d::Costmap2DROS* costmap_ros, bool use_static_costmap);  
+  bool IsUsingStaticCostmap() const { return using_static_costmap_; }
 //  double RecoveryCircleCost(double x, double y, double theta, const std::vector<geometry_msgs::Point>& footprint_spec, geometry_msgs::PoseStamped* goal_pose);
   double RecoveryCircleCost(const geometry_msgs::PoseStamped& current_pos, const std::vector<geometry_msgs::Point>& footprint_spec, geometry_msgs::PoseStamped* goal_pose);
 
@@ -58,12 +60,11 @@ class FootprintChecker {
       double new_x = x + (center_x * cos_th - center_y * sin_th);
       double new_y = y + (center_x * sin_th + center_y * cos_th);
 
-      unsigned int cell_x, cell_y;
-      if (!costmap_->worldToMap(new_x, new_y, cell_x, cell_y)) {
+      unsigned char cost;
+      if (!WorldCost(new_x, new_y, &cost)) {
 //        return 0.0;
         return -200.0;
       }
-      unsigned char cost = costmap_->getCost(cell_x, cell_y);
       if (cost == costmap_2d::NO_INFORMATION) {
         return -101.0;
 			} else if (cost >= costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
@@ -85,11 +86,10 @@ class FootprintChecker {
       double new_x = x + (footprint_center_points[i].x * cos_th - footprint_center_points[i].y * sin_th);
       double new_y = y + (footprint_center_points[i].x * sin_th + footprint_center_points[i].y * cos_th);
 
-      unsigned int cell_x, cell_y;
-      if (!costmap_->worldToMap(new_x, new_y, cell_x, cell_y)) {
+      unsigned char cost;
+      if (!WorldCost(new_x, new_y, &cost)) {
         ++check_cost_cnt;
       } else {
-        unsigned char cost = costmap_->getCost(cell_x, cell_y);
         GAUSSIAN_INFO("[Footprint_Checker] footprint_center[%d].cost = %d, check_cnt = %d",i, cost, check_cost_cnt + 1);
         if (cost >= costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
           ++check_cost_cnt;
@@ -160,6 +160,27 @@ class FootprintChecker {
   double FootprintCost(const geometry_msgs::Point& position, const std::vector<geometry_msgs::Point>& footprint,
                        double inscribed_radius, double circumscribed_radius);
  private:
+  /**
+   * @brief  Get cost of a point in world coordinates, planner_costmap_ is used where costmap_ doesn't cover
+   * @param wx The x position of the point in world coordinates
+   * @param wy The y position of the point in world coordinates
+   * @param cost Will be filled with the cost of the point
+   * @return False if the point is off both costmaps
+   */
+  bool WorldCost(double wx, double wy, unsigned char* cost) const {
+    unsigned int cell_x, cell_y;
+    if (costmap_->worldToMap(wx, wy, cell_x, cell_y)) {
+      *cost = costmap_->getCost(cell_x, cell_y);
+      return true;
+    }
+    if (using_static_costmap_ || planner_costmap_ == NULL || planner_costmap_ == costmap_
+        || !planner_costmap_->worldToMap(wx, wy, cell_x, cell_y)) {
+      return false;
+    }
+    *cost = planner_costmap_->getCost(cell_x, cell_y);
+    return true;
+  }
+
   /**
    * @brief  Rasterizes a line in the costmap grid and checks for collisions
    * @param x0 The x position of the first cell in grid coordinates
@@ -179,6 +200,8 @@ class FootprintChecker {
   double PointCost(int x, int y);
 
   const costmap_2d::Costmap2D* costmap_;  ///< @brief Allows access of costmap obstacle information
+  const costmap_2d::Costmap2D* planner_costmap_;  ///< @brief Fallback where costmap_ doesn't cover
+  bool using_static_costmap_;             ///< @brief True if costmap_ points to the static costmap
 };
 
 };  // namespace service_robot
@@ -133,7 +133,11 @@ class ServiceRobot {
   tf::TransformListener& tf_;
 
   boost::shared_ptr<fixpattern_local_planner::FixPatternTrajectoryPlannerROS> fixpattern_local_planner_;
+  // slow global costmap for planners, and small high-rate rolling costmap for
+  // controller if split_controller_costmap_ is set, otherwise they are the same
+  costmap_2d::Costmap2DROS *planner_costmap_ros_;
   costmap_2d::Costmap2DROS *controller_costmap_ros_;
+  bool split_controller_costmap_;
 
 //  std::vector<BaseController*> controllers_;
 //  std::vector<BaseControlOption*> options_;
@@ -185,6 +189,7 @@ class ServiceRobot {
   double init_path_circle_center_extend_y_;
   double recovery_footprint_extend_x_;
   double recovery_footprint_extend_y_;
+  std::string cycle_record_file_;
 
   // sbpl param
   std::vector<geometry_msgs::Point> circle_center_points_;
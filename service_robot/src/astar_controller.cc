@@ -14,12 +14,118 @@
 #include <nav_msgs/Path.h>
 #include <angles/angles.h>
 #include <std_msgs/UInt32.h>
+#include <string.h>
 
 namespace service_robot {
 
+namespace {
+
+// poses closer than this share one safety memo bucket
+const double kSafetyMemoXYStep = 0.005;
+const double kSafetyMemoQuatStep = 0.0025;
+// protector status is polled with this period, and regarded as stale if no
+// successful poll within timeout
+const double kProtectorPollPeriod = 0.05;
+const double kProtectorStaleTimeout = 0.5;
+// bezier splice of front path is reused while robot stays this close to
+// where it was made
+const double kBezierSpliceDisDiff = 0.02;
+const double kBezierSpliceYawDiff = 0.02;
+// how long to wait for protector thread to exit, it's left behind after this
+const double kProtectorJoinTimeout = 1.0;
+// when sbpl can't reach the temp goal of an inserted middle path, try this
+// many goals further along fixpattern_path, this far apart
+const size_t kFurtherGoalNum = 3;
+const double kFurtherGoalStep = 0.5;
+const uint64_t kFnvOffset = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+  return (seed ^ value) * kFnvPrime;
+}
+
+inline uint64_t HashDouble(uint64_t seed, double value, double step = 0.0001) {
+  return HashCombine(seed, static_cast<uint64_t>(static_cast<int64_t>(floor(value / step))));
+}
+
+uint64_t HashPose(uint64_t seed, const geometry_msgs::PoseStamped& pose) {
+  seed = HashDouble(seed, pose.pose.position.x, kSafetyMemoXYStep);
+  seed = HashDouble(seed, pose.pose.position.y, kSafetyMemoXYStep);
+  seed = HashDouble(seed, pose.pose.orientation.z, kSafetyMemoQuatStep);
+  return HashDouble(seed, pose.pose.orientation.w, kSafetyMemoQuatStep);
+}
+
+uint64_t HashPathPoint(uint64_t seed, const fixpattern_path::PathPoint& point) {
+  seed = HashDouble(seed, point.position.x, kSafetyMemoXYStep);
+  seed = HashDouble(seed, point.position.y, kSafetyMemoXYStep);
+  seed = HashDouble(seed, point.orientation.z, kSafetyMemoQuatStep);
+  return HashDouble(seed, point.orientation.w, kSafetyMemoQuatStep);
+}
+
+// hash poses visited by walking path from begin_index with stride, which is
+// negative for walking backward, until length is covered
+uint64_t HashPathWindow(uint64_t seed, const std::vector<fixpattern_path::PathPoint>& path,
+                        int begin_index, int stride, double length) {
+  double accu_dis = 0.0;
+  for (int i = begin_index; i >= 0 && i < static_cast<int>(path.size()); i += stride) {
+    seed = HashPathPoint(seed, path[i]);
+    if (i != begin_index) accu_dis += path[i].DistanceToPoint(path[i - stride]);
+    if (accu_dis >= length) break;
+  }
+  return seed;
+}
+
+// same as HashPathWindow, but also keyed on path size and begin_index since
+// CheckFixPathFrontSafe and IsPathFootprintSafe memoize indexes of path
+uint64_t HashPathSamples(uint64_t seed, const std::vector<fixpattern_path::PathPoint>& path,
+                         int begin_index, int stride, double length) {
+  seed = HashCombine(seed, path.size());
+  seed = HashCombine(seed, begin_index);
+  return HashPathWindow(seed, path, begin_index, stride, length);
+}
+
+int FindPathPoint(const std::vector<fixpattern_path::PathPoint>& path,
+                  const fixpattern_path::PathPoint& point) {
+  for (int i = 0; i < static_cast<int>(path.size()); ++i) {
+    if (path[i].DistanceToPoint(point) < 0.0001) return i;
+  }
+  return -1;
+}
+
+// fingerprint of costmap content, geometry included since a rolling window
+// costmap moves its origin without touching cell costs
+uint64_t CostmapFingerprint(const costmap_2d::Costmap2D& costmap) {
+  uint64_t seed = kFnvOffset;
+  unsigned int size_x = costmap.getSizeInCellsX();
+  unsigned int size_y = costmap.getSizeInCellsY();
+  seed = HashCombine(seed, size_x);
+  seed = HashCombine(seed, size_y);
+  seed = HashDouble(seed, costmap.getOriginX(), 0.000001);
+  seed = HashDouble(seed, costmap.getOriginY(), 0.000001);
+  const unsigned char* cells = costmap.getCharMap();
+  size_t size = static_cast<size_t>(size_x) * size_y;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, cells + i, sizeof(word));
+    seed = HashCombine(seed, word);
+  }
+  for (; i < size; ++i) seed = HashCombine(seed, cells[i]);
+  return seed;
+}
+
+// same check as the local planner does on plan points
+bool IsSamePathPoint(const fixpattern_path::PathPoint& a, const fixpattern_path::PathPoint& b) {
+  return a.position.x == b.position.x && a.position.y == b.position.y &&
+         a.orientation.z == b.orientation.z && a.orientation.w == b.orientation.w;
+}
+
+};  // namespace
+
 AStarController::AStarController(tf::TransformListener* tf,
+                                 costmap_2d::Costmap2DROS* planner_costmap_ros,
                                  costmap_2d::Costmap2DROS* controller_costmap_ros)
-    : tf_(*tf),
+    : tf_(*tf), planner_costmap_ros_(planner_costmap_ros),
       controller_costmap_ros_(controller_costmap_ros), planner_plan_(NULL), 
       planner_goal_index_(0), sbpl_reached_goal_(false), 
       runPlanner_(false), new_global_plan_(false), first_run_controller_flag_(true), gotInitPlan_(false),
@@ -30,7 +136,11 @@ AStarController::AStarController(tf::TransformListener* tf,
   planner_plan_ = new std::vector<geometry_msgs::PoseStamped>();
 
   // create footprint_checker_
-  footprint_checker_ = new service_robot::FootprintChecker(controller_costmap_ros_->getCostmap());
+  footprint_checker_ = new service_robot::FootprintChecker(controller_costmap_ros_->getCostmap(),
+                                                           planner_costmap_ros_->getCostmap());
+  // costmap_ros keeps refreshing this same Costmap2D, fingerprinting it
+  // doesn't refresh it again
+  controller_costmap_ = controller_costmap_ros_->getCostmap();
 
   footprint_spec_ = controller_costmap_ros_->getRobotFootprint();
   unpadded_footrpint_spec_ = controller_costmap_ros_->getUnpaddedRobotFootprint();
@@ -49,12 +159,18 @@ AStarController::AStarController(tf::TransformListener* tf,
 
   using_static_costmap_ = false;
   switch_path_ = false;
+  switch_cursor_ = 0;
+  bezier_spliced_ = false;
+  fix_path_replaced_ = true;
   origin_path_safe_cnt_ = 0;
   // set rotate_recovery_dir_
   rotate_recovery_dir_ = 0;
   rotate_failure_times_ = 0;
   try_recovery_times_ = 0;
   cmd_vel_ratio_ = 1.0;
+  costmap_revision_ = 0;
+  controller_costmap_fingerprint_ = kFnvOffset;
+  planner_costmap_fingerprint_ = kFnvOffset;
 
   // set for fixpattern_path
   ros::NodeHandle fixpattern_nh("~/fixpattern_global_planner");
@@ -69,17 +185,32 @@ AStarController::AStarController(tf::TransformListener* tf,
   astar_start_pub_ = n.advertise<geometry_msgs::PoseStamped>("a_start", 10);
   sbpl_goal_pub_ = n.advertise<geometry_msgs::PoseStamped>("s_temp_goal", 10);
   astar_extend_pose_pub_ = n.advertise<geometry_msgs::PoseStamped>("a_extend_pose", 10);
+  planner_costmap_latency_pub_ = n.advertise<std_msgs::Float64>("planner_costmap_latency", 10);
+  controller_costmap_latency_pub_ = n.advertise<std_msgs::Float64>("controller_costmap_latency", 10);
 
   localization_sub_ = n.subscribe<std_msgs::Int8>("/localization_bit", 100, boost::bind(&AStarController::LocalizationCallBack, this, _1));
 
   start_rotate_client_ = device_nh.serviceClient<autoscrubber_services::StartRotate>("start_rotate");
   stop_rotate_client_ = device_nh.serviceClient<autoscrubber_services::StopRotate>("stop_rotate");
   check_rotate_client_ = device_nh.serviceClient<autoscrubber_services::CheckRotate>("check_rotate");
-  check_protector_client_ = device_nh.serviceClient<autoscrubber_services::CheckProtectorStatus>("check_protector_status");
+  protector_poller_.reset(new ProtectorPoller());
+  protector_poller_->client = device_nh.serviceClient<autoscrubber_services::CheckProtectorStatus>("check_protector_status");
   check_goal_srv_ = n.advertiseService("check_goal", &AStarController::CheckGoalIsSafe, this);
+
+  // set up the protector polling thread
+  protector_thread_ = new boost::thread(boost::bind(&AStarController::ProtectorThread, protector_poller_));
 }
 
 AStarController::~AStarController() {
+  // a hanging service call can't be interrupted, don't wait for it forever,
+  // the thread only touches protector_poller_ which it keeps alive
+  protector_thread_->interrupt();
+  if (!protector_thread_->timed_join(boost::posix_time::milliseconds(static_cast<int>(kProtectorJoinTimeout * 1000)))) {
+    GAUSSIAN_WARN("[ASTAR CONTROLLER] protector thread doesn't exit, detach it");
+    protector_thread_->detach();
+  }
+  delete protector_thread_;
+
   planner_thread_->interrupt();
   planner_thread_->join();
 
@@ -107,7 +238,7 @@ bool AStarController::CheckGoalIsSafe(autoscrubber_services::CheckGoal::Request&
   return true;
 }
 
-bool AStarController::MakePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>* plan) {
+bool AStarController::MakePlan(const geometry_msgs::PoseStamped& start, geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>* plan) {
 
   // make sure to set the plan to be empty initially
   plan->clear();
@@ -184,7 +315,12 @@ bool AStarController::MakePlan(const geometry_msgs::PoseStamped& start, const ge
     // if the planner fails or returns a zero length plan, planning failed
     if (!co_->sbpl_global_planner->makePlan(start, goal, *plan, astar_path_, sbpl_broader_, state_ != A_PLANNING) || plan->empty()) {
       GAUSSIAN_ERROR("[ASTAR PLANNER] s_planner failed to find a plan to point (%.2f, %.2f)", goal.pose.position.x, goal.pose.position.y);
-      return false;
+      // middle path can join fixpattern_path anywhere behind the obstacle
+      if (state_ != FIX_CONTROLLING || planning_state_ != P_INSERTING_MIDDLE ||
+          !MakeSbplPlanToFurtherGoal(start, goal, plan)) {
+        return false;
+      }
+      gotInitPlan_ = true;
     } else {
       gotInitPlan_ = true;
       GAUSSIAN_INFO("[ASTAR PLANNER] got s path size = %zu, path len = %lf", astar_path_.path().size(), astar_path_.Length());
@@ -344,7 +480,23 @@ void AStarController::PlanThread() {
     }
     GAUSSIAN_INFO("[ASTAR PLANNER] Plan Start!");
     ros::Time start_time = ros::Time::now();
-//    controller_costmap_ros_->getCostmap();
+    // costmap is updated when calling getCostmap(), publish how long it takes.
+    // controller costmap is refreshed by control cycle, refreshing it here
+    // too would race with the safety checks running on it
+    if (planner_costmap_ros_ != controller_costmap_ros_) {
+      double costmap_t = GetTimeInSeconds();
+      costmap_2d::Costmap2D* planner_costmap = planner_costmap_ros_->getCostmap();
+      std_msgs::Float64 planner_costmap_latency;
+      planner_costmap_latency.data = GetTimeInSeconds() - costmap_t;
+      planner_costmap_latency_pub_.publish(planner_costmap_latency);
+      // footprint checker falls back to planner costmap out of controller
+      // costmap, so memoized safety checks are stale once its content changes
+      uint64_t fingerprint = CostmapFingerprint(*planner_costmap);
+      if (fingerprint != planner_costmap_fingerprint_) {
+        planner_costmap_fingerprint_ = fingerprint;
+        BumpCostmapRevision();
+      }
+    }
  
     // time to plan! get a copy of the goal and unlock the mutex
     geometry_msgs::PoseStamped temp_goal = planner_goal_;
@@ -412,14 +564,17 @@ void AStarController::PlanThread() {
         astar_planner_timeout_cnt_ = 0;
         lock.lock();
         front_path_.set_path(co_->fixpattern_path->path(), false, false);
+        PrepareSwitchingPath();
         front_goal_ = temp_goal;
         // TODO(lizhen) final path but middle state?
         if (taken_global_goal_ || planning_state_ == P_INSERTING_NONE) {
           if (using_sbpl_directly_) {
             co_->fixpattern_path->set_sbpl_path(start, astar_path_.path(), true);
+            fix_path_replaced_ = true;
             gotInitPlan_ = true;
           } else {
             co_->fixpattern_path->set_path(astar_path_.path(), false, false);
+            fix_path_replaced_ = true;
             // check fix_path is safe: if not, get goal on path and switch to PLANNING state 
             if (RecheckFixPath(start, using_static_costmap_)) {
               GAUSSIAN_INFO("[ASTAR CONTROLLER] recheck fixpath successed!");
@@ -436,14 +591,17 @@ void AStarController::PlanThread() {
         } else if (planning_state_ == P_INSERTING_BEGIN) {
           double corner_yaw_diff = state_ == A_PLANNING ? M_PI / 36.0 : M_PI / 3.0;
           co_->fixpattern_path->insert_begin_path(astar_path_.path(), start, temp_goal, false, corner_yaw_diff, using_sbpl_directly_);
+          fix_path_replaced_ = true;
           first_run_controller_flag_ = true;
           switch_path_ = true;
           origin_path_safe_cnt_ = 0;
         } else if (planning_state_ == P_INSERTING_END) {
           co_->fixpattern_path->insert_end_path(astar_path_.path());
+          fix_path_replaced_ = true;
           first_run_controller_flag_ = true;
         } else if (planning_state_ == P_INSERTING_MIDDLE) {
           co_->fixpattern_path->insert_middle_path(astar_path_.path(), start, temp_goal);
+          fix_path_replaced_ = true;
           front_safe_check_cnt_ = 0; // only set 0 after getting new fix_path
           switch_path_ = true;
           origin_path_safe_cnt_ = 0;
@@ -486,6 +644,11 @@ void AStarController::PlanThread() {
             state_ = FIX_CONTROLLING;
           }
         } 
+        // profile the new path here rather than in the next control cycle
+        if (fix_path_replaced_) {
+          planned_path_ = std::make_shared<const std::vector<fixpattern_path::PathPoint> >(co_->fixpattern_path->path());
+          planned_profile_ = co_->fixpattern_local_planner->makeVelocityProfile(*planned_path_);
+        }
         lock.unlock();
       }
     } else if (state_ == A_PLANNING) {  // if we didn't get a plan and we are in the planning state (the robot isn't moving)
@@ -680,7 +843,7 @@ bool AStarController::Control(BaseControlOption* option, ControlEnvironment* env
       bool init_path_got = GetAStarInitialPath(current_position, global_goal_);
       co_->astar_global_planner->setStaticCosmap(false);
       if (init_path_got) {
-        std::vector<geometry_msgs::PoseStamped> fix_path = co_->fixpattern_path->GeometryPath();
+        const std::vector<fixpattern_path::PathPoint>& fix_path = co_->fixpattern_path->path();
         // check fix_path is safe: if not, get astar goal on path and switch to PLANNING state 
         if (CheckFixPathFrontSafe(fix_path, co_->front_safe_check_dis, 0.0, 0.0) < 1.5) {
           if (GetAStarGoal(current_position, 0.0, 0.0, obstacle_index_)) {
@@ -740,6 +903,7 @@ bool AStarController::Control(BaseControlOption* option, ControlEnvironment* env
    
         // we need to notify fixpattern_path
         co_->fixpattern_path->FinishPath();
+        fix_path_replaced_ = true;
         GAUSSIAN_WARN("[ASTAR CONTROLLER] Control Teminated, stop and break this loop");
         // set pause_flag = false, to let service_robot know this loop terminated
         env_->pause_flag = false;
@@ -751,6 +915,7 @@ bool AStarController::Control(BaseControlOption* option, ControlEnvironment* env
    
       // the real work on pursuing a goal is done here
       bool done = ExecuteCycle();
+      RecordCycle(done, (ros::WallTime::now() - start).toSec());
    
       // if we done, we'll disable run_flag and break this loop
       if (done) {
@@ -780,13 +945,51 @@ bool AStarController::Control(BaseControlOption* option, ControlEnvironment* env
   return true;
 }
 
+void AStarController::RecordCycle(bool done, double cycle_time) {
+  if (co_->cycle_record_file.empty()) return;
+  if (!cycle_record_stream_.is_open()) {
+    cycle_record_stream_.open(co_->cycle_record_file.c_str(), std::ios::out | std::ios::app);
+    if (!cycle_record_stream_.is_open()) {
+      GAUSSIAN_ERROR("[ASTAR CONTROLLER] cannot open cycle record file %s, disable recording", co_->cycle_record_file.c_str());
+      co_->cycle_record_file.clear();
+      return;
+    }
+    cycle_record_stream_ << "stamp,cycle_time,costmap_time,switch_time,prune_time,front_check_time,local_planner_time,"
+                         << "state_before,state,recovery_trigger,planning_state,x,y,yaw,goal_x,goal_y,goal_yaw,cmd_vx,cmd_vth,"
+                         << "costmap_revision,done"
+                         << std::endl;
+  }
+  cycle_record_.cycle_time = cycle_time;
+  cycle_record_.state = state_;
+  cycle_record_.recovery_trigger = recovery_trigger_;
+  cycle_record_.planning_state = planning_state_;
+  cycle_record_.goal = global_goal_;
+  cycle_record_.costmap_revision = CostmapRevision();
+  cycle_record_.done = done;
+
+  const CycleRecord& r = cycle_record_;
+  cycle_record_stream_ << std::fixed
+      << r.stamp << "," << r.cycle_time << "," << r.costmap_time << "," << r.switch_time << ","
+      << r.prune_time << "," << r.front_check_time << "," << r.local_planner_time << ","
+      << r.state_before << "," << r.state << "," << r.recovery_trigger << "," << r.planning_state << ","
+      << r.pose.pose.position.x << "," << r.pose.pose.position.y << "," << tf::getYaw(r.pose.pose.orientation) << ","
+      << r.goal.pose.position.x << "," << r.goal.pose.position.y << "," << tf::getYaw(r.goal.pose.orientation) << ","
+      << r.cmd_vel.linear.x << "," << r.cmd_vel.angular.z << "," << r.costmap_revision << "," << r.done << "\n";
+  // flush when done so a finished goal is always complete on disk
+  if (done) cycle_record_stream_.flush();
+}
+
 void AStarController::ClearFootprintInCostmap(const geometry_msgs::PoseStamped& pose, double clear_extend_dis, bool is_static_needed) {
   controller_costmap_ros_->clearFootprintInCostmap(pose.pose.position.x, pose.pose.position.y, 
                                                    tf::getYaw(pose.pose.orientation), clear_extend_dis);
+  if (planner_costmap_ros_ != controller_costmap_ros_) {
+    planner_costmap_ros_->clearFootprintInCostmap(pose.pose.position.x, pose.pose.position.y,
+                                                  tf::getYaw(pose.pose.orientation), clear_extend_dis);
+  }
   // clear current pose footprint on static costmap
   if (is_static_needed) {	
-    controller_costmap_ros_->clearFootprintInCostmap(controller_costmap_ros_->getStaticCostmap(), pose.pose.position.x,
-                                                     pose.pose.position.y, tf::getYaw(pose.pose.orientation), clear_extend_dis);
+    planner_costmap_ros_->clearFootprintInCostmap(planner_costmap_ros_->getStaticCostmap(), pose.pose.position.x,
+                                                  pose.pose.position.y, tf::getYaw(pose.pose.orientation), clear_extend_dis);
   }
 }
 
@@ -802,69 +1005,133 @@ bool AStarController::IsGoalUnreachable(const geometry_msgs::PoseStamped& goal_p
 }
 
 bool AStarController::IsGoalSafe(const geometry_msgs::PoseStamped& goal_pose, double goal_front_check_dis, double goal_back_check_dis, bool using_static_costmap) {
-  footprint_checker_->setStaticCostmap(controller_costmap_ros_, using_static_costmap);
+  footprint_checker_->setStaticCostmap(using_static_costmap ? planner_costmap_ros_ : controller_costmap_ros_, using_static_costmap);
+
+  // static costmap has no revision, only memoize checks on normal costmap
+  SafetyCheckMemo memo;
+  if (!using_static_costmap) {
+    memo.revision = CostmapRevision();
+    memo.key = HashPose(kFnvOffset, goal_pose);
+    memo.key = HashDouble(memo.key, goal_front_check_dis);
+    memo.key = HashDouble(memo.key, goal_back_check_dis);
+    // IsGoalFootprintSafe(0.5, 0.0) below only visits path poses in 0.5m
+    // before goal and the one right after it
+    const std::vector<fixpattern_path::PathPoint>& fix_path = co_->fixpattern_path->path();
+    int goal_index = FindPathPoint(fix_path, fixpattern_path::GeometryPoseToPathPoint(goal_pose.pose));
+    memo.key = HashCombine(memo.key, goal_index == -1 ? 0 : 1);
+    if (goal_index != -1) {
+      memo.key = HashPathWindow(memo.key, fix_path, goal_index - 1, -5, 0.5);
+      memo.key = HashPathWindow(memo.key, fix_path, goal_index + 1, 5, 0.0);
+    }
+    SafetyCheckMemo hit;
+    if (LookupSafetyMemo(goal_safe_memo_, memo.key, memo.revision, &hit)) {
+      return hit.result > 0.0;
+    }
+  }
+
+  bool is_safe = IsGoalFootprintSafe(0.5, 0.0, goal_pose);
+  if (is_safe) {
+    double resolution = controller_costmap_ros_->getCostmap()->getResolution();
+    int front_num_step = goal_front_check_dis / resolution;
+    int back_num_step = (-1) * goal_back_check_dis / resolution;
+
+    double yaw = tf::getYaw(goal_pose.pose.orientation);
+    std::vector<geometry_msgs::PoseStamped> path;
+    for (int i = back_num_step; i <= front_num_step; ++i) {
+      geometry_msgs::PoseStamped p;
+      p.pose.position.x = goal_pose.pose.position.x + i * resolution * cos(yaw);
+      p.pose.position.y = goal_pose.pose.position.y + i * resolution * sin(yaw);
+      p.pose.orientation = goal_pose.pose.orientation;
+      path.push_back(p);
+    }
+    for (int i = 0; i < path.size(); ++i) {
+      if (footprint_checker_->CircleCenterCost(path[i].pose.position.x, path[i].pose.position.y, yaw, co_->circle_center_points, 0.0, 0.0) < 0) {
+//      if (footprint_checker_->FootprintCost(path[i].pose.position.x, path[i].pose.position.y, yaw, footprint_spec_, 0.0, 0.0) < 0) {
+        is_safe = false;
+        break;
+      }
+    }
+  }
+
+  if (!using_static_costmap) {
+    memo.result = is_safe ? 1.0 : -1.0;
+    StoreSafetyMemo(&goal_safe_memo_, memo);
+  }
+  return is_safe;
+}
 
-  if (!IsGoalFootprintSafe(0.5, 0.0, goal_pose)) {
+bool AStarController::MakeSbplPlanToFurtherGoal(const geometry_msgs::PoseStamped& start, geometry_msgs::PoseStamped& goal,
+                                                std::vector<geometry_msgs::PoseStamped>* plan) {
+  const std::vector<fixpattern_path::PathPoint>& fix_path = co_->fixpattern_path->path();
+  int goal_index = FindPathPoint(fix_path, fixpattern_path::GeometryPoseToPathPoint(goal.pose));
+  if (goal_index == -1) {
     return false;
   }
-  double resolution = controller_costmap_ros_->getCostmap()->getResolution();
-  int front_num_step = goal_front_check_dis / resolution;
-  int back_num_step = (-1) * goal_back_check_dis / resolution;
-	
-  double yaw = tf::getYaw(goal_pose.pose.orientation);
-  std::vector<geometry_msgs::PoseStamped> path;
-  for (int i = back_num_step; i <= front_num_step; ++i) {
-    geometry_msgs::PoseStamped p;
-    p.pose.position.x = goal_pose.pose.position.x + i * resolution * cos(yaw);
-    p.pose.position.y = goal_pose.pose.position.y + i * resolution * sin(yaw);
-    p.pose.orientation = goal_pose.pose.orientation;
-    path.push_back(p);
+
+  // safe goals every kFurtherGoalStep behind goal, within reach of sbpl
+  std::vector<geometry_msgs::PoseStamped> goals;
+  double dis_accu = 0.0;
+  for (int i = goal_index + 1; i < static_cast<int>(fix_path.size()) && goals.size() < kFurtherGoalNum; ++i) {
+    dis_accu += fix_path[i].DistanceToPoint(fix_path[i - 1]);
+    if (dis_accu < kFurtherGoalStep * (goals.size() + 1)) continue;
+    geometry_msgs::PoseStamped pose = fixpattern_path::PathPointToGeometryPoseStamped(fix_path[i]);
+    pose.header.frame_id = co_->global_frame;
+    if (PoseStampedDistance(start, pose) > co_->sbpl_max_distance) break;
+    if (!IsGoalFootprintSafe(0.4, 0.3, pose)) continue;
+    goals.push_back(pose);
+  }
+  if (goals.empty()) {
+    return false;
   }
-  for (int i = 0; i < path.size(); ++i) {
-    if (footprint_checker_->CircleCenterCost(path[i].pose.position.x, path[i].pose.position.y, yaw, co_->circle_center_points, 0.0, 0.0) < 0) {
-//    if (footprint_checker_->FootprintCost(path[i].pose.position.x, path[i].pose.position.y, yaw, footprint_spec_, 0.0, 0.0) < 0) {
-      return false;
-    }
+
+  std::vector<std::vector<geometry_msgs::PoseStamped> > plans;
+  std::vector<fixpattern_path::Path> paths;
+  if (co_->sbpl_global_planner->makePlans(start, goals, &plans, &paths, sbpl_broader_) == 0) {
+    GAUSSIAN_WARN("[ASTAR PLANNER] s_planner failed to find a plan to %zu further goals", goals.size());
+    return false;
   }
-  return true;
+  // nearest one leaves most of fixpattern_path in place
+  for (size_t i = 0; i < goals.size(); ++i) {
+    if (plans[i].empty()) continue;
+    GAUSSIAN_INFO("[ASTAR PLANNER] take further goal %zu (%.2f, %.2f)", i, goals[i].pose.position.x, goals[i].pose.position.y);
+    goal = goals[i];
+    *plan = plans[i];
+    astar_path_ = paths[i];
+    return true;
+  }
+  return false;
 }
 
 bool AStarController::IsGoalFootprintSafe(double goal_safe_dis_a, double goal_safe_dis_b, const geometry_msgs::PoseStamped& pose) {
-  std::vector<geometry_msgs::PoseStamped> fix_path = co_->fixpattern_path->GeometryPath();
-  int goal_index = -1;
-  for (int i = 0; i < static_cast<int>(fix_path.size()); ++i) {
-    if (PoseStampedDistance(fix_path[i], pose) < 0.0001) {
-      goal_index = i;
-      break;
-    }
-  }
+  const std::vector<fixpattern_path::PathPoint>& fix_path = co_->fixpattern_path->path();
+  int goal_index = FindPathPoint(fix_path, fixpattern_path::GeometryPoseToPathPoint(pose.pose));
   if (goal_index == -1) {
     return true;
   }
   double free_dis_a = 0.0;
   for (int i = goal_index - 1; i >= 0; i -= 5) {
-    double x = fix_path[i].pose.position.x;
-    double y = fix_path[i].pose.position.y;
-    double yaw = tf::getYaw(fix_path[i].pose.orientation);
+    double x = fix_path[i].position.x;
+    double y = fix_path[i].position.y;
+    double yaw = tf::getYaw(fix_path[i].orientation);
     if (footprint_checker_->CircleCenterCost(x, y, yaw, co_->circle_center_points, 0.0, 0.0) < 0) {
 //      GAUSSIAN_WARN("[ASTAR CONTROLLER] goal front not safe");
       return false;
     }
-    free_dis_a += PoseStampedDistance(fix_path[i], fix_path[i + 5]);
+    free_dis_a += fix_path[i].DistanceToPoint(fix_path[i + 5]);
     if (free_dis_a >= goal_safe_dis_a) {
       break;
     }
   }
   double free_dis_b = 0.0;
   for (int i = goal_index + 1; i < fix_path.size(); i += 5) {
-    double x = fix_path[i].pose.position.x;
-    double y = fix_path[i].pose.position.y;
-    double yaw = tf::getYaw(fix_path[i].pose.orientation);
+    double x = fix_path[i].position.x;
+    double y = fix_path[i].position.y;
+    double yaw = tf::getYaw(fix_path[i].orientation);
     if (footprint_checker_->CircleCenterCost(x, y, yaw, co_->circle_center_points, 0.0, 0.0) < 0) {
 //      GAUSSIAN_WARN("[ASTAR CONTROLLER] goal back not safe");
       return false;
     }
-    free_dis_b += PoseStampedDistance(fix_path[i], fix_path[i - 5]);
+    free_dis_b += fix_path[i].DistanceToPoint(fix_path[i - 5]);
     if (free_dis_b >= goal_safe_dis_b) {
       break;
     }
@@ -872,66 +1139,95 @@ bool AStarController::IsGoalFootprintSafe(double goal_safe_dis_a, double goal_sa
   return true;
 }
 
-bool AStarController::IsPathFootprintSafe(const std::vector<geometry_msgs::PoseStamped>& path,
+bool AStarController::IsPathFootprintSafe(const std::vector<fixpattern_path::PathPoint>& path,
                                           const std::vector<geometry_msgs::Point>& circle_center_points,
                                           double length) {
   double accu_dis = 0.0;
   for (int i = 0; i < path.size(); i += 5) {
-    double yaw = tf::getYaw(path[i].pose.orientation);
-    if (footprint_checker_->CircleCenterCost(path[i].pose.position.x, path[i].pose.position.y,
+    double yaw = tf::getYaw(path[i].orientation);
+    if (footprint_checker_->CircleCenterCost(path[i].position.x, path[i].position.y,
                                              yaw, circle_center_points, 0.0, 0.0) < 0) {
       return false;
     }
-    if (i != 0) accu_dis +=PoseStampedDistance(path[i], path[i - 5]);
+    if (i != 0) accu_dis += path[i].DistanceToPoint(path[i - 5]);
     if (accu_dis >= length) return true;
   }
   return true;
 }
 
 bool AStarController::IsPathFootprintSafe(const fixpattern_path::Path& fix_path, double length) {
-  std::vector<geometry_msgs::PoseStamped> path = fix_path.GeometryPath();
-  if (IsPathFootprintSafe(path, co_->circle_center_points, length)) {
-    return true;
-  }
+  const std::vector<fixpattern_path::PathPoint>& path = fix_path.path();
 
-  if (fabs(co_->sbpl_footprint_padding) < GS_DOUBLE_PRECISION) return false;
-  GAUSSIAN_WARN("[ASTAR CONTROLLER] origin fix_path footprint is not safe");
-	
-  // if not safe, let's cast some padding to footprint
-  std::vector<geometry_msgs::Point> circle_center_points_padding_1 = co_->circle_center_points;
-  for (auto&& p : circle_center_points_padding_1) p.y +=co_->sbpl_footprint_padding;
-  if (IsPathFootprintSafe(path, circle_center_points_padding_1, length)) {
-    return true;
+  SafetyCheckMemo memo;
+  bool use_memo = !footprint_checker_->IsUsingStaticCostmap();
+  if (use_memo) {
+    memo.revision = CostmapRevision();
+    memo.key = HashPathSamples(kFnvOffset, path, 0, 5, length);
+    memo.key = HashDouble(memo.key, length);
+    memo.key = HashDouble(memo.key, co_->sbpl_footprint_padding);
+    SafetyCheckMemo hit;
+    if (LookupSafetyMemo(path_safe_memo_, memo.key, memo.revision, &hit)) {
+      return hit.result > 0.0;
+    }
   }
-  GAUSSIAN_WARN("[ASTAR CONTROLLER] pandding up fix_path footprint is not safe");
 
-  // okay okay, the other padding
-  std::vector<geometry_msgs::Point> circle_center_points_padding_2 = co_->circle_center_points;
-  for (auto&& p : circle_center_points_padding_2) p.y -= co_->sbpl_footprint_padding;
-  if (IsPathFootprintSafe(path, circle_center_points_padding_2, length)) {
-    return true;
+  bool is_safe = IsPathFootprintSafe(path, co_->circle_center_points, length);
+  if (!is_safe && fabs(co_->sbpl_footprint_padding) >= GS_DOUBLE_PRECISION) {
+    GAUSSIAN_WARN("[ASTAR CONTROLLER] origin fix_path footprint is not safe");
+
+    // if not safe, let's cast some padding to footprint
+    std::vector<geometry_msgs::Point> circle_center_points_padding_1 = co_->circle_center_points;
+    for (auto&& p : circle_center_points_padding_1) p.y +=co_->sbpl_footprint_padding;
+    is_safe = IsPathFootprintSafe(path, circle_center_points_padding_1, length);
+    if (!is_safe) {
+      GAUSSIAN_WARN("[ASTAR CONTROLLER] pandding up fix_path footprint is not safe");
+
+      // okay okay, the other padding
+      std::vector<geometry_msgs::Point> circle_center_points_padding_2 = co_->circle_center_points;
+      for (auto&& p : circle_center_points_padding_2) p.y -= co_->sbpl_footprint_padding;
+      is_safe = IsPathFootprintSafe(path, circle_center_points_padding_2, length);
+      if (!is_safe) GAUSSIAN_WARN("[ASTAR CONTROLLER] pandding down fix_path footprint is not safe");
+    }
   }
-  GAUSSIAN_WARN("[ASTAR CONTROLLER] pandding down fix_path footprint is not safe");
 
-  // at last...
-  return false;
+  if (use_memo) {
+    memo.result = is_safe ? 1.0 : -1.0;
+    StoreSafetyMemo(&path_safe_memo_, memo);
+  }
+  return is_safe;
 }
 
-double AStarController::CheckFixPathFrontSafe(const std::vector<geometry_msgs::PoseStamped>& path, double front_safe_check_dis, double extend_x, double extend_y, int begin_index) {
+double AStarController::CheckFixPathFrontSafe(const std::vector<fixpattern_path::PathPoint>& path, double front_safe_check_dis, double extend_x, double extend_y, int begin_index) {
+  SafetyCheckMemo memo;
+  bool use_memo = !footprint_checker_->IsUsingStaticCostmap();
+  if (use_memo) {
+    memo.revision = CostmapRevision();
+    memo.key = HashPathSamples(kFnvOffset, path, begin_index, 5, front_safe_check_dis);
+    memo.key = HashDouble(memo.key, front_safe_check_dis);
+    memo.key = HashDouble(memo.key, extend_x);
+    memo.key = HashDouble(memo.key, extend_y);
+    SafetyCheckMemo hit;
+    if (LookupSafetyMemo(front_safe_memo_, memo.key, memo.revision, &hit)) {
+      if (hit.obstacle_index >= 0) obstacle_index_ = hit.obstacle_index;
+      front_goal_index_ = hit.front_goal_index;
+      return hit.result;
+    }
+  }
+
   double accu_dis = 0.0;
   double off_obstacle_dis = 0.0;
   bool cross_obstacle = false;
   int i, j;
   unsigned int temp_goal_index = 0;
   for (i = begin_index; i < path.size(); i += 5) {
-    double yaw = tf::getYaw(path[i].pose.orientation);
-    if (footprint_checker_->CircleCenterCost(path[i].pose.position.x, path[i].pose.position.y,
+    double yaw = tf::getYaw(path[i].orientation);
+    if (footprint_checker_->CircleCenterCost(path[i].position.x, path[i].position.y,
                                              yaw, co_->circle_center_points, extend_x, extend_y) < 0) {
       cross_obstacle = true;
       obstacle_index_ = i;
       break;
     }
-    if (i != 0) accu_dis += PoseStampedDistance(path[i], path[i - 5]);
+    if (i != begin_index) accu_dis += path[i].DistanceToPoint(path[i - 5]);
     if (temp_goal_index ==0 && accu_dis >= 1.5) temp_goal_index = i;
     if (accu_dis >= front_safe_check_dis) break;
   }
@@ -939,6 +1235,13 @@ double AStarController::CheckFixPathFrontSafe(const std::vector<geometry_msgs::P
     accu_dis = front_safe_check_dis + 0.001;
 
   front_goal_index_ = temp_goal_index;
+
+  if (use_memo) {
+    memo.result = accu_dis;
+    memo.obstacle_index = cross_obstacle ? i : -1;
+    memo.front_goal_index = temp_goal_index;
+    StoreSafetyMemo(&front_safe_memo_, memo);
+  }
   return accu_dis;
 }
 
@@ -1075,6 +1378,18 @@ bool AStarController::IsFixPathFrontSafe(double front_safe_check_dis) {
 }
 
 bool AStarController::NeedBackward(const geometry_msgs::PoseStamped& pose, double distance) {
+  SafetyCheckMemo memo;
+  bool use_memo = !footprint_checker_->IsUsingStaticCostmap();
+  if (use_memo) {
+    memo.revision = CostmapRevision();
+    memo.key = HashPose(kFnvOffset, pose);
+    memo.key = HashDouble(memo.key, distance);
+    SafetyCheckMemo hit;
+    if (LookupSafetyMemo(need_backward_memo_, memo.key, memo.revision, &hit)) {
+      return hit.result > 0.0;
+    }
+  }
+
   double yaw = tf::getYaw(pose.pose.orientation);
   double resolution = controller_costmap_ros_->getCostmap()->getResolution() / 3.0;
   int num_step = distance / resolution;
@@ -1088,14 +1403,53 @@ bool AStarController::NeedBackward(const geometry_msgs::PoseStamped& pose, doubl
     p.pose.orientation = pose.pose.orientation;
     path.push_back(p);
   }
+  bool need_backward = false;
   for (int i = 0; i < path.size(); ++i) {
     if (footprint_checker_->CircleCenterCost(path[i].pose.position.x, path[i].pose.position.y, yaw,
                                              co_->footprint_center_points, 0.0, 0.0) < 0) {
       GAUSSIAN_INFO("[ASTAR CONTROLLER] distance = %lf, not safe step = %d", distance, i);
-      return true;
+      need_backward = true;
+      break;
     }
   }
-  return false;
+
+  if (use_memo) {
+    memo.result = need_backward ? 1.0 : -1.0;
+    StoreSafetyMemo(&need_backward_memo_, memo);
+  }
+  return need_backward;
+}
+
+void AStarController::BumpCostmapRevision() {
+  boost::mutex::scoped_lock lock(safety_memo_mutex_);
+  ++costmap_revision_;
+}
+
+unsigned int AStarController::CostmapRevision() {
+  // every getCostmap() refreshes controller costmap, wherever it's called, so
+  // follow its content instead of the calls
+  uint64_t fingerprint = CostmapFingerprint(*controller_costmap_);
+  boost::mutex::scoped_lock lock(safety_memo_mutex_);
+  if (fingerprint != controller_costmap_fingerprint_) {
+    controller_costmap_fingerprint_ = fingerprint;
+    ++costmap_revision_;
+  }
+  return costmap_revision_;
+}
+
+bool AStarController::LookupSafetyMemo(const SafetyCheckMemo& memo, uint64_t key, unsigned int revision, SafetyCheckMemo* hit) {
+  boost::mutex::scoped_lock lock(safety_memo_mutex_);
+  if (!memo.valid || memo.key != key || memo.revision != revision) {
+    return false;
+  }
+  *hit = memo;
+  return true;
+}
+
+void AStarController::StoreSafetyMemo(SafetyCheckMemo* memo, const SafetyCheckMemo& value) {
+  boost::mutex::scoped_lock lock(safety_memo_mutex_);
+  *memo = value;
+  memo->valid = true;
 }
 
 double AStarController::PoseStampedDistance(const geometry_msgs::PoseStamped& p1, const geometry_msgs::PoseStamped& p2) {
@@ -1106,6 +1460,9 @@ bool AStarController::ExecuteCycle() {
   // we need to be able to publish velocity commands
   double t0, t1, t2, t3, t4, t5;
   t0 = GetTimeInSeconds();
+  cycle_record_ = CycleRecord();
+  cycle_record_.stamp = ros::Time::now().toSec();
+  cycle_record_.state_before = state_;
 
   geometry_msgs::Twist cmd_vel;
   // get curent position
@@ -1116,6 +1473,7 @@ bool AStarController::ExecuteCycle() {
     return false;
   } else {
     tf::poseStampedTFToMsg(global_pose, current_position);
+    cycle_record_.pose = current_position;
   }
   double cur_goal_distance = PoseStampedDistance(current_position, global_goal_);
 //  GAUSSIAN_INFO("[ASTAR CONTROLLER]:cur_goal_distance = %lf", cur_goal_distance);
@@ -1126,7 +1484,11 @@ bool AStarController::ExecuteCycle() {
   }
 
   // check that the observation buffers for the costmap are current, we don't want to drive blind
+  double costmap_t = GetTimeInSeconds();
   controller_costmap_ros_->getCostmap();
+  std_msgs::Float64 controller_costmap_latency;
+  controller_costmap_latency.data = GetTimeInSeconds() - costmap_t;
+  controller_costmap_latency_pub_.publish(controller_costmap_latency);
   if (!controller_costmap_ros_->isCurrent()) {
     GAUSSIAN_WARN("[%s]:Sensor data is out of date, we're not going to allow commanding of the base for safety", ros::this_node::getName().c_str());
     PublishZeroVelocity();
@@ -1157,6 +1519,7 @@ bool AStarController::ExecuteCycle() {
   }
   
   t1 = GetTimeInSeconds();
+  cycle_record_.costmap_time = t1 - t0;
   if (t1 - t0 > 0.02) {
     GAUSSIAN_INFO("get costmap cost %lf sec", t1 - t0);
   }
@@ -1188,6 +1551,7 @@ bool AStarController::ExecuteCycle() {
 
         // we need to notify fixpattern_path
         co_->fixpattern_path->FinishPath();
+        fix_path_replaced_ = true;
 
         // check is global goal reached
         if (!IsGlobalGoalReached(current_position, global_goal_, 
@@ -1200,8 +1564,13 @@ bool AStarController::ExecuteCycle() {
         } else {
           // publish goal reached 
           if (global_goal_type_ == CHARGING) {
-            HeadingChargingGoal(charging_goal_);
+            bool charging_goal_reached = HeadingChargingGoal(charging_goal_);
             co_->fixpattern_local_planner->resetGoalTolerance();
+            if (!charging_goal_reached) {
+              PublishMovebaseStatus(I_GOAL_UNREACHED);
+              GAUSSIAN_ERROR("[FIXPATTERN CONTROLLER] charging goal not reached, teminate controller");
+              return true;
+            }
           }
           PublishGoalReached(global_goal_);
           PublishMovebaseStatus(I_GOAL_REACHED);
@@ -1226,6 +1595,7 @@ bool AStarController::ExecuteCycle() {
       HandleSwitchingPath(current_position);
 
       t2 = GetTimeInSeconds();
+      cycle_record_.switch_time = t2 - t1;
       if (t2 - t1 > 0.04) {
         GAUSSIAN_INFO("check reached goal and HandleSwitch cost %lf sec", t2 - t1);
       }
@@ -1236,6 +1606,7 @@ bool AStarController::ExecuteCycle() {
       } else if (!co_->fixpattern_local_planner->isGoalXYLatched()) {
         if(co_->fixpattern_local_planner->isRotatingToGoalDone()) {
           co_->fixpattern_path->PruneCornerOnStart();
+          fix_path_replaced_ = true;
           co_->fixpattern_local_planner->resetRotatingToGoalDone();
           GAUSSIAN_INFO("[FIXPATTERN CONTROLLER] Prune Corner Point On Start");  
         } else {
@@ -1263,6 +1634,7 @@ bool AStarController::ExecuteCycle() {
       }
 */
       t3 = GetTimeInSeconds();
+      cycle_record_.prune_time = t3 - t2;
       if (t3 - t2 > 0.04) {
         GAUSSIAN_INFO("Prune path cost %lf sec", t3 - t2);
       }
@@ -1276,6 +1648,14 @@ bool AStarController::ExecuteCycle() {
         recovery_trigger_ = FIX_OSCILLATION_R;
       }
 
+			// protector status out of date, hold the base until it's back instead of
+      // triggering recovery, just like out of date sensor data
+      if (IsProtectorStatusStale()) {
+        GAUSSIAN_WARN("[FIXPATTERN CONTROLLER] protector status is out of date, we're not going to allow commanding of the base for safety");
+        PublishZeroVelocity();
+        return false;
+      }
+
 			// check for protector status and handle going back if front detected
       if (CheckProtector(current_position)) {
         GAUSSIAN_ERROR("[FIXPATTERN CONTROLLER] check front protector, then swtich to FIX_GETNEWGOAL_R state");
@@ -1287,7 +1667,7 @@ bool AStarController::ExecuteCycle() {
 			// check for front path or goal is safe or not  
       {      
         cmd_vel_ratio_ = 1.0;
-        std::vector<geometry_msgs::PoseStamped> fix_path = co_->fixpattern_path->GeometryPath();
+        const std::vector<fixpattern_path::PathPoint>& fix_path = co_->fixpattern_path->path();
         double front_safe_dis = CheckFixPathFrontSafe(fix_path, co_->front_safe_check_dis, 0.0, 0.0);
         // when cur pose is closed to global_goal, check if goal safe 
         if (cur_goal_distance < co_->goal_safe_check_dis
@@ -1331,6 +1711,7 @@ bool AStarController::ExecuteCycle() {
               ResetState();
               // we need to notify fixpattern_path
               co_->fixpattern_path->FinishPath();
+              fix_path_replaced_ = true;
 
               // TODO(chenkan): check if this is needed
               co_->fixpattern_local_planner->reset_planner();
@@ -1383,7 +1764,8 @@ bool AStarController::ExecuteCycle() {
               controller_costmap_ros_->getRobotPose(global_pose);
               tf::poseStampedTFToMsg(global_pose, current_position);
               if (HandleGoingBack(current_position) || !switch_path_ || 
-                  (switch_path_ && PoseStampedDistance(current_position, co_->fixpattern_path->GeometryPath().front()) > 0.07)) {
+                  (switch_path_ && co_->fixpattern_path->path().front().DistanceToPoint(
+                      fixpattern_path::GeometryPoseToPathPoint(current_position.pose)) > 0.07)) {
                 GAUSSIAN_ERROR("[FIXPATTERN CONTROLLER] !IsPathFrontSafe dis = %lf, stop and switch to CLEARING", front_safe_dis);
                 state_ = FIX_CLEARING;
                 recovery_trigger_ = FIX_GETNEWGOAL_R;
@@ -1435,23 +1817,27 @@ bool AStarController::ExecuteCycle() {
       }
 
       t4 = GetTimeInSeconds();
+      cycle_record_.front_check_time = t4 - t3;
       if (t4 - t3 > 0.04) {
         GAUSSIAN_INFO("Check front path cost %lf sec", t4 - t3);
       }
 
       {
-        if (!co_->fixpattern_local_planner->setPlan(co_->fixpattern_path->path(), co_->global_frame)) {
+        if (!SetLocalPlannerPlan()) {
           // ABORT and SHUTDOWN COSTMAPS
           GAUSSIAN_ERROR("Failed to pass global plan to the controller, aborting.");
           ResetState();
           return true;
         }
-        std::vector<geometry_msgs::PoseStamped> plan = co_->fixpattern_path->GeometryPath();
-        for (auto&& p : plan) {  // NOLINT
-          p.header.frame_id = co_->global_frame;
-          p.header.stamp = ros::Time::now();
+        // path is only for display, don't convert it if nobody is listening
+        if (fixpattern_pub_.getNumSubscribers() > 0) {
+          std::vector<geometry_msgs::PoseStamped> plan = co_->fixpattern_path->GeometryPath();
+          for (auto&& p : plan) {  // NOLINT
+            p.header.frame_id = co_->global_frame;
+            p.header.stamp = ros::Time::now();
+          }
+          PublishPlan(fixpattern_pub_, plan);
         }
-        PublishPlan(fixpattern_pub_, plan);
       }
 
       {
@@ -1491,6 +1877,7 @@ bool AStarController::ExecuteCycle() {
           // make sure that we send the velocity command to the base
           co_->vel_pub->publish(cmd_vel);
           last_valid_cmd_vel_ = cmd_vel;
+          cycle_record_.cmd_vel = cmd_vel;
           // notify room_server to play_sound 
           PublishHeadingGoal();
           // notify gs_consle
@@ -1529,6 +1916,7 @@ bool AStarController::ExecuteCycle() {
       }
 
       t5 = GetTimeInSeconds();
+      cycle_record_.local_planner_time = t5 - t4;
       if (t5 - t4 > 0.06) {
         GAUSSIAN_INFO("Local planner cost %lf sec", t5 - t4);
       }
@@ -1688,6 +2076,7 @@ bool AStarController::ExecuteCycle() {
 
           // we need to notify fixpattern_path
           co_->fixpattern_path->FinishPath();
+          fix_path_replaced_ = true;
 
           GAUSSIAN_ERROR("[FIX CONTROLLER] GetAStarGoal failed, terminate path");
           // TODO(lizhen) Alarm here
@@ -1717,13 +2106,14 @@ void AStarController::ResetState() {
   // Disable the planner thread
   boost::unique_lock<boost::mutex> lock(planner_mutex_);
   runPlanner_ = false;
+  front_path_.FinishPath();
+  PrepareSwitchingPath();
   lock.unlock();
 
   // Reset statemachine
   state_ = A_PLANNING;
   recovery_trigger_ = A_PLANNING_R;
   PublishZeroVelocity();
-  front_path_.FinishPath();
   switch_path_ = false;
   origin_path_safe_cnt_ = 0;
 /*
@@ -1983,6 +2373,7 @@ bool AStarController::GetAStarInitialPath(const geometry_msgs::PoseStamped& glob
     std::vector<fixpattern_path::PathPoint> fix_path;
     SampleInitialPath(planner_plan_, fix_path);
     co_->fixpattern_path->set_fix_path(global_start, fix_path, true); 
+    fix_path_replaced_ = true;
 
     // check fix_path is safe: if not, get  goal on path and switch to PLANNING state 
     
@@ -2006,13 +2397,55 @@ bool AStarController::GetAStarInitialPath(const geometry_msgs::PoseStamped& glob
   }
 }
 
+bool AStarController::SetLocalPlannerPlan() {
+  const std::vector<fixpattern_path::PathPoint>& fix_path = co_->fixpattern_path->path();
+  if (fix_path.empty()) {
+    return false;
+  }
+  // Prune only erases from the front, so until fixpattern_path is replaced it stays
+  // a suffix of the path last handed over, and the local planner keeps its velocity profile
+  size_t offset = 0;
+  bool reuse = !fix_path_replaced_ && local_plan_path_ && fix_path.size() <= local_plan_path_->size();
+  if (reuse) {
+    offset = local_plan_path_->size() - fix_path.size();
+    reuse = IsSamePathPoint(fix_path.front(), (*local_plan_path_)[offset]) &&
+            IsSamePathPoint(fix_path.back(), local_plan_path_->back());
+  }
+  std::shared_ptr<const fixpattern_local_planner::VelocityProfile> profile;
+  if (!reuse) {
+    // take path and profile from planner thread if fixpattern_path is still them, pruned
+    // or not, a path replaced on this thread is profiled by local planner
+    boost::unique_lock<boost::mutex> lock(planner_mutex_);
+    offset = 0;
+    // control cycle may have spliced it since, which keeps both ends, so compare all of it
+    if (planned_path_ && fix_path.size() <= planned_path_->size()) {
+      offset = planned_path_->size() - fix_path.size();
+      size_t i = 0;
+      while (i < fix_path.size() && IsSamePathPoint(fix_path[i], (*planned_path_)[offset + i])) ++i;
+      if (i == fix_path.size()) {
+        local_plan_path_ = planned_path_;
+        profile = planned_profile_;
+      }
+    }
+    if (!profile) {
+      local_plan_path_ = std::make_shared<const std::vector<fixpattern_path::PathPoint> >(fix_path);
+      offset = 0;
+    }
+    planned_path_.reset();
+    planned_profile_.reset();
+    fix_path_replaced_ = false;
+  }
+  co_->fixpattern_local_planner->setCostmapRevision(CostmapRevision());
+  return co_->fixpattern_local_planner->setPlan(local_plan_path_, offset, co_->global_frame, profile);
+}
+
 bool AStarController::RecheckFixPath(const geometry_msgs::PoseStamped& global_start, bool using_static_costmap) {
   // set footprint_checker costmap is static or not
-  footprint_checker_->setStaticCostmap(controller_costmap_ros_, using_static_costmap);
+  footprint_checker_->setStaticCostmap(using_static_costmap ? planner_costmap_ros_ : controller_costmap_ros_, using_static_costmap);
   // check fix_path is safe: if not, get goal on path and switch to PLANNING state 
   int try_count = 10;	
   while(--try_count > 0) {
-    if (CheckFixPathFrontSafe(co_->fixpattern_path->GeometryPath(), co_->fixpattern_path->Length(), 0.0, co_->init_path_circle_center_extend_y) < co_->fixpattern_path->Length() - 0.30, 0) {
+    if (CheckFixPathFrontSafe(co_->fixpattern_path->path(), co_->fixpattern_path->Length(), 0.0, co_->init_path_circle_center_extend_y) < co_->fixpattern_path->Length() - 0.30) {
       GetAStarGoal(global_start, 0.0, co_->init_path_circle_center_extend_y, obstacle_index_);
       GetAStarStart(co_->fixpattern_path->Length(), 0.0, co_->init_path_circle_center_extend_y, obstacle_index_);
       GAUSSIAN_ERROR("[ASTAR CONTROLLER] RecheckFixPath: path_not safe, start to recheck and replan");
@@ -2023,45 +2456,62 @@ bool AStarController::RecheckFixPath(const geometry_msgs::PoseStamped& global_st
       if (!co_->sbpl_global_planner->makePlan(planner_start_, planner_goal_, *planner_plan_, temp_sbpl_path, false, false)
           || planner_plan_->empty()) {
         GAUSSIAN_ERROR("[ASTAR CONTROLLER] RecheckFixPath: sbpl failed to find a plan to point (%.2f, %.2f)", planner_goal_.pose.position.x, planner_goal_.pose.position.y);
-      } else {
-        co_->fixpattern_path->insert_middle_path(temp_sbpl_path.path(), planner_start_, planner_goal_);
-        GAUSSIAN_INFO("[ASTAR CONTROLLER] RecheckFixPath: after inserting sbpl path, fix_path length = %lf", co_->fixpattern_path->Length());
+        // like a middle path, it can join fixpattern_path anywhere behind the obstacle
+        geometry_msgs::PoseStamped goal = planner_goal_;
+        if (!MakeSbplPlanToFurtherGoal(planner_start_, goal, planner_plan_)) {
+          // nothing changed, trying again would plan the same
+          break;
+        }
+        planner_goal_ = goal;
+        temp_sbpl_path = astar_path_;
       }
+      co_->fixpattern_path->insert_middle_path(temp_sbpl_path.path(), planner_start_, planner_goal_);
+      fix_path_replaced_ = true;
+      GAUSSIAN_INFO("[ASTAR CONTROLLER] RecheckFixPath: after inserting sbpl path, fix_path length = %lf", co_->fixpattern_path->Length());
     } else {
       GAUSSIAN_INFO("[ASTAR CONTROLLER] RecheckFixPath: check fixpath safe, updated successed!");
       return true;
     }
   } 
 
-  if (try_count <= 0) {
-    GAUSSIAN_WARN("[ASTAR CONTROLLER] RecheckFixPath: check fixpath not safe then 10 times, return false!");
-    return false;
-  }	
+  GAUSSIAN_WARN("[ASTAR CONTROLLER] RecheckFixPath: check fixpath not safe and no more plan to insert, return false!");
+  return false;
 }
 
 bool AStarController::HandleSwitchingPath(geometry_msgs::PoseStamped current_position, bool switch_directly) {
+  // planner thread sets front_path_ and switch points, keep them from changing under the cursor
+  boost::unique_lock<boost::mutex> lock(planner_mutex_);
   if (switch_path_ && switch_directly) {
-    co_->fixpattern_path->set_path(front_path_.path(), false, false); 
+    co_->fixpattern_path->set_path(SwitchingPathPoints(), false, false); 
+    fix_path_replaced_ = true;
     return true;
   }
   if (!switch_path_) return false; 
-  if (front_path_.path().size() < 30 || front_path_.Length() < 1.0 || 
+
+  // advance cursor to the closest point, it replaces pruning front_path_ and
+  // costs amortized O(1) since robot moves forward along front path
+  fixpattern_path::PathPoint current_point = fixpattern_path::GeometryPoseToPathPoint(current_position.pose);
+  while (switch_cursor_ + 1 < switch_points_.size() &&
+         switch_points_[switch_cursor_ + 1].DistanceToPoint(current_point) <=
+         switch_points_[switch_cursor_].DistanceToPoint(current_point)) {
+    ++switch_cursor_;
+  }
+  double switch_path_length = switch_accu_dis_.empty() ? 0.0 : switch_accu_dis_.back() - switch_accu_dis_[switch_cursor_];
+  if (switch_points_.size() - switch_cursor_ < 30 || switch_path_length < 1.0 || 
       PoseStampedDistance(planner_start_, current_position) > 1.5 || 
       PoseStampedDistance(front_goal_, current_position) < 1.5) {
     switch_path_ = false;
     return false;
   }
 
-  fixpattern_path::PathPoint start_pose = fixpattern_path::GeometryPoseToPathPoint(current_position.pose); 
-  front_path_.Prune(start_pose, 0.8, M_PI / 2.0, false);
-  double dis_diff, yaw_diff;
   // handle corner point diffrent from others
   if (co_->fixpattern_path->path().front().corner_struct.corner_point) {
-    if (front_path_.CheckCurPoseOnPath(start_pose, co_->switch_corner_dis_diff, co_->switch_corner_yaw_diff)) {
-      if (CheckFixPathFrontSafe(front_path_.GeometryPath(), co_->front_safe_check_dis, 0.0, co_->init_path_circle_center_extend_y) > 2.0 &&
-          front_path_.Length() - co_->fixpattern_path->Length() < 0.0 &&
+    if (IsPoseOnSwitchingPath(current_position, co_->switch_corner_dis_diff, co_->switch_corner_yaw_diff)) {
+      if (CheckFixPathFrontSafe(switch_points_, co_->front_safe_check_dis, 0.0, co_->init_path_circle_center_extend_y, switch_cursor_) > 2.0 &&
+          switch_path_length - co_->fixpattern_path->Length() < 0.0 &&
           ++origin_path_safe_cnt_ > 2) {
-        co_->fixpattern_path->set_fix_path(current_position, front_path_.path(), false, true); 
+        co_->fixpattern_path->set_fix_path(current_position, SwitchingPathPoints(), false, true); 
+        fix_path_replaced_ = true;
         first_run_controller_flag_ = true;
         switch_path_ = false;
         GAUSSIAN_INFO("[ASTAR CONTROLLER] corner: switch origin path as fix path");
@@ -2071,27 +2521,45 @@ bool AStarController::HandleSwitchingPath(geometry_msgs::PoseStamped current_pos
       switch_path_ = false;
     }
   } else {
-    if (CheckFixPathFrontSafe(front_path_.GeometryPath(), co_->front_safe_check_dis, 0.0, co_->init_path_circle_center_extend_y) > 2.0 &&
-        front_path_.Length() - co_->fixpattern_path->Length() < 0.0) {
-      if (front_path_.CheckCurPoseOnPath(start_pose, co_->switch_normal_dis_diff, co_->switch_normal_yaw_diff)) { 
-        co_->fixpattern_path->set_fix_path(current_position, front_path_.path(), false, false); 
+    if (CheckFixPathFrontSafe(switch_points_, co_->front_safe_check_dis, 0.0, co_->init_path_circle_center_extend_y, switch_cursor_) > 2.0 &&
+        switch_path_length - co_->fixpattern_path->Length() < 0.0) {
+      if (IsPoseOnSwitchingPath(current_position, co_->switch_normal_dis_diff, co_->switch_normal_yaw_diff)) { 
+        co_->fixpattern_path->set_fix_path(current_position, SwitchingPathPoints(), false, false); 
+        fix_path_replaced_ = true;
         switch_path_ = false;
         GAUSSIAN_INFO("[ASTAR CONTROLLER] switch origin path as fix path");
       } else {
         bool get_bezier_plan = false;
         std::vector<fixpattern_path::PathPoint> bezier_path;
-        if (front_goal_index_ > 0 && front_goal_index_ < front_path_.GeometryPath().size()) {
-          geometry_msgs::PoseStamped goal = front_path_.GeometryPath().at(front_goal_index_);
-          if (MakeBezierPlan(&bezier_path, current_position, goal, false)) {
-            astar_path_.set_bezier_path(current_position, bezier_path, false);
-            front_path_.insert_begin_path(astar_path_.path(), current_position, goal, false, M_PI / 3.0);
+        // front_goal_index_ is an index of switch_points_ here
+        if (front_goal_index_ > switch_cursor_ && front_goal_index_ < switch_points_.size()) {
+          const fixpattern_path::PathPoint& goal_point = switch_points_.at(front_goal_index_);
+          if (bezier_spliced_ && bezier_splice_goal_.DistanceToPoint(goal_point) < kBezierSpliceDisDiff &&
+              bezier_splice_start_.DistanceToPoint(current_point) < kBezierSpliceDisDiff &&
+              fabs(angles::shortest_angular_distance(tf::getYaw(bezier_splice_start_.orientation),
+                                                     tf::getYaw(current_point.orientation))) < kBezierSpliceYawDiff) {
+            // same splice as last one, front path already has it
             get_bezier_plan = true;
+          } else {
+            geometry_msgs::PoseStamped goal = fixpattern_path::PathPointToGeometryPoseStamped(goal_point);
+            if (MakeBezierPlan(&bezier_path, current_position, goal, false)) {
+              astar_path_.set_bezier_path(current_position, bezier_path, false);
+              front_path_.set_path(SwitchingPathPoints(), false, false);
+              front_path_.insert_begin_path(astar_path_.path(), current_position, goal, false, M_PI / 3.0);
+              // front path is spliced, precompute it again
+              PrepareSwitchingPath();
+              bezier_spliced_ = true;
+              bezier_splice_start_ = current_point;
+              bezier_splice_goal_ = fixpattern_path::GeometryPoseToPathPoint(goal.pose);
+              get_bezier_plan = true;
+            }
           }
         }
         if(get_bezier_plan && ++origin_path_safe_cnt_ > 10 &&
-           CheckFixPathFrontSafe(front_path_.GeometryPath(), co_->front_safe_check_dis, 0.0, co_->init_path_circle_center_extend_y) > 2.0 &&
-           front_path_.Length() - co_->fixpattern_path->Length() < 0.0) {
-          co_->fixpattern_path->set_fix_path(current_position, front_path_.path(), false, false); 
+           CheckFixPathFrontSafe(switch_points_, co_->front_safe_check_dis, 0.0, co_->init_path_circle_center_extend_y, switch_cursor_) > 2.0 &&
+           switch_accu_dis_.back() - switch_accu_dis_[switch_cursor_] - co_->fixpattern_path->Length() < 0.0) {
+          co_->fixpattern_path->set_fix_path(current_position, SwitchingPathPoints(), false, false); 
+          fix_path_replaced_ = true;
           first_run_controller_flag_ = true;
           switch_path_ = false;
           GAUSSIAN_INFO("[ASTAR CONTROLLER] switch origin path as fix path");
@@ -2102,14 +2570,75 @@ bool AStarController::HandleSwitchingPath(geometry_msgs::PoseStamped current_pos
   }
   return true;
 }
+
+void AStarController::PrepareSwitchingPath() {
+  switch_points_ = front_path_.path();
+  switch_accu_dis_.resize(switch_points_.size());
+  double accu_dis = 0.0;
+  for (int i = 0; i < static_cast<int>(switch_points_.size()); ++i) {
+    if (i != 0) accu_dis += switch_points_[i].DistanceToPoint(switch_points_[i - 1]);
+    switch_accu_dis_[i] = accu_dis;
+  }
+  switch_cursor_ = 0;
+  bezier_spliced_ = false;
+}
+
+std::vector<fixpattern_path::PathPoint> AStarController::SwitchingPathPoints() {
+  if (switch_cursor_ >= switch_points_.size()) return std::vector<fixpattern_path::PathPoint>();
+  return std::vector<fixpattern_path::PathPoint>(switch_points_.begin() + switch_cursor_, switch_points_.end());
+}
+
+bool AStarController::IsPoseOnSwitchingPath(const geometry_msgs::PoseStamped& pose, double dis_diff, double yaw_diff) {
+  if (switch_cursor_ >= switch_points_.size()) return false;
+  const fixpattern_path::PathPoint& closest = switch_points_[switch_cursor_];
+  return closest.DistanceToPoint(fixpattern_path::GeometryPoseToPathPoint(pose.pose)) < dis_diff &&
+         fabs(angles::shortest_angular_distance(tf::getYaw(closest.orientation),
+                                                tf::getYaw(pose.pose.orientation))) < yaw_diff;
+}
+
+void AStarController::ProtectorThread(boost::shared_ptr<ProtectorPoller> poller) {
+  GAUSSIAN_INFO("[ASTAR CONTROLLER] Starting protector thread...");
+  ros::NodeHandle n;
+  // robots without protector service keep meaning no protector detected, status
+  // only goes stale once the service has shown up
+  while (n.ok() && !poller->client.waitForExistence(ros::Duration(kProtectorStaleTimeout))) {
+    boost::this_thread::interruption_point();
+  }
+  {
+    boost::mutex::scoped_lock lock(poller->mutex);
+    poller->state.available = true;
+    poller->state.stamp = GetTimeInSeconds();
+  }
+  while (n.ok()) {
+    autoscrubber_services::CheckProtectorStatus protector_status;
+    if (poller->client.call(protector_status)) {
+      boost::mutex::scoped_lock lock(poller->mutex);
+      poller->state.protect_status = protector_status.response.protector_status.protect_status;
+      poller->state.protect_value = protector_status.response.protector_status.protect_value;
+      poller->state.stamp = GetTimeInSeconds();
+    }
+    // interruption point, so destructor can stop this thread
+    boost::this_thread::sleep(boost::posix_time::milliseconds(static_cast<int>(kProtectorPollPeriod * 1000)));
+  }
+}
+
+bool AStarController::IsProtectorStatusStale() {
+  boost::mutex::scoped_lock lock(protector_poller_->mutex);
+  return protector_poller_->state.available &&
+         GetTimeInSeconds() - protector_poller_->state.stamp > kProtectorStaleTimeout;
+}
+
 bool AStarController::CheckProtector(geometry_msgs::PoseStamped& current_position, bool detect_front_protector) {
-  autoscrubber_services::CheckProtectorStatus protector_status;
-  check_protector_client_.call(protector_status);
-  bool b_protector_status = protector_status.response.protector_status.protect_status;
+  ProtectorState protector_state;
+  {
+    boost::mutex::scoped_lock lock(protector_poller_->mutex);
+    protector_state = protector_poller_->state;
+  }
+  bool b_protector_status = protector_state.protect_status;
   GAUSSIAN_WARN("[FIXPATTERN CONTROLLER] check protector status = %d", b_protector_status);
   bool b_front_protector_detected = true;
   if (b_protector_status && detect_front_protector) {
-    unsigned int protector_value = protector_status.response.protector_status.protect_value;
+    unsigned int protector_value = protector_state.protect_value;
     b_front_protector_detected = false;
     for (int i = 0; i < co_->front_protector_list.size(); ++i) {
       GAUSSIAN_WARN("[FIXPATTERN CONTROLLER] check protector status bit[%d]", co_->front_protector_list.at(i));
@@ -2156,6 +2685,12 @@ bool AStarController::HeadingChargingGoal(const geometry_msgs::PoseStamped& char
   geometry_msgs::PoseStamped cur_pos;
   ros::Rate control_rate(co_->controller_frequency);
   while (!CheckProtector(cur_pos, false) && env_->run_flag) {
+    // protector status out of date, contact with charger can't be told
+    if (IsProtectorStatusStale()) {
+      GAUSSIAN_ERROR("[ASTAR CONTROLLER] charging: protector status is out of date, stop here!");
+      PublishZeroVelocity();
+      return false;
+    }
     // get curent position
     controller_costmap_ros_->getRobotPose(global_pose);
     tf::poseStampedTFToMsg(global_pose, cur_pos);
@@ -0,0 +1,285 @@
+/* Copyright(C) Gaussian Automation. All rights reserved.
+ */
+
+/**
+ * @file cycle_record_replay.cc
+ * @brief replay AStarController cycle records offline and check a candidate
+ *        run against a baseline run for decision and timing regressions
+ * @author cameron<chenkan@gs-robot.com>
+ * @version 1.0.0.0
+ * @date 2016-12-28
+ *
+ * Records are written by AStarController when ~cycle_record_file is set. Play
+ * the same bag with use_sim_time through the baseline and the candidate build,
+ * then run
+ *
+ *   cycle_record_replay baseline.csv [candidate.csv] [timing_tolerance]
+ *
+ * With one file the tool only prints its per-goal decision trace and stage
+ * timings. With two it also compares them goal by goal and exits with 1 if the
+ * decision traces diverge or a stage's p95 time grew by more than
+ * timing_tolerance (default 0.2, i.e. 20%). Exits with 2 on unreadable input.
+ * It has no ROS dependency and runs on any Linux machine.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* kStages[] = {
+  "cycle_time", "costmap_time", "switch_time", "prune_time", "front_check_time", "local_planner_time",
+};
+const int kStageNum = sizeof(kStages) / sizeof(kStages[0]);
+// growth below this is scheduler noise, not a regression
+const double kMinTimingRegression = 0.001;
+// goals closer than this are the same goal
+const double kSameGoalDistance = 0.01;
+
+const char* kStateNames[] = {"A_PLANNING", "FIX_CONTROLLING", "FIX_CLEARING"};
+const char* kRecoveryNames[] = {
+  "A_PLANNING_R", "FIX_CONTROLLING_R", "GLOBAL_PLANNER_RECOVERY_R", "LOCAL_PLANNER_RECOVERY_R",
+  "FIX_GETNEWGOAL_R", "FIX_FRONTSAFE_R", "FIX_OSCILLATION_R", "LOCATION_RECOVERY_R", "BACKWARD_RECOVERY_R",
+};
+const char* kPlanningNames[] = {
+  "P_INSERTING_NONE", "P_INSERTING_BEGIN", "P_INSERTING_END", "P_INSERTING_MIDDLE", "P_INSERTING_SBPL",
+};
+
+const char* EnumName(const char** names, int size, int value) {
+  return value >= 0 && value < size ? names[value] : "UNKNOWN";
+}
+
+struct Decision {
+  int state;
+  int recovery_trigger;
+  int planning_state;
+  bool done;
+
+  bool operator==(const Decision& other) const {
+    return state == other.state && recovery_trigger == other.recovery_trigger &&
+           planning_state == other.planning_state && done == other.done;
+  }
+  bool operator!=(const Decision& other) const { return !(*this == other); }
+};
+
+std::string DecisionString(const Decision& d) {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%s/%s/%s%s", EnumName(kStateNames, 3, d.state),
+           EnumName(kRecoveryNames, 9, d.recovery_trigger), EnumName(kPlanningNames, 5, d.planning_state),
+           d.done ? "/done" : "");
+  return buf;
+}
+
+struct Cycle {
+  double stamp;
+  double x, y;
+  double goal_x, goal_y;
+  double stage_times[kStageNum];
+  Decision decision;
+};
+
+// cycles towards one goal, with consecutive equal decisions collapsed into the trace
+struct GoalRun {
+  double goal_x, goal_y;
+  std::vector<Cycle> cycles;
+  std::vector<Decision> trace;
+  std::vector<size_t> trace_cycle;  // cycle index where each trace entry starts
+};
+
+struct Record {
+  std::string file;
+  std::vector<Cycle> cycles;
+  std::vector<GoalRun> goals;
+};
+
+bool ReadRecord(const std::string& file, Record* record) {
+  std::ifstream in(file.c_str());
+  if (!in.is_open()) {
+    fprintf(stderr, "cannot open %s\n", file.c_str());
+    return false;
+  }
+  record->file = file;
+
+  std::string line;
+  if (!std::getline(in, line)) {
+    fprintf(stderr, "%s is empty\n", file.c_str());
+    return false;
+  }
+  // look columns up by name so records from older builds still load
+  std::map<std::string, int> columns;
+  std::stringstream header(line);
+  std::string name;
+  for (int i = 0; std::getline(header, name, ','); ++i) columns[name] = i;
+  const char* required[] = {
+    "stamp", "state", "recovery_trigger", "planning_state", "x", "y", "goal_x", "goal_y", "done",
+  };
+  for (size_t i = 0; i < sizeof(required) / sizeof(required[0]); ++i) {
+    if (columns.find(required[i]) == columns.end()) {
+      fprintf(stderr, "%s has no %s column\n", file.c_str(), required[i]);
+      return false;
+    }
+  }
+
+  int line_num = 1;
+  while (std::getline(in, line)) {
+    ++line_num;
+    if (line.empty()) continue;
+    // a second header means the controller restarted and appended to the file
+    if (line.compare(0, 6, "stamp,") == 0) continue;
+    std::vector<double> values;
+    std::stringstream row(line);
+    std::string field;
+    while (std::getline(row, field, ',')) values.push_back(atof(field.c_str()));
+    if (values.size() < columns.size()) {
+      fprintf(stderr, "%s:%d has %zu fields, expected %zu\n", file.c_str(), line_num, values.size(), columns.size());
+      return false;
+    }
+
+    Cycle c;
+    c.stamp = values[columns["stamp"]];
+    c.x = values[columns["x"]];
+    c.y = values[columns["y"]];
+    c.goal_x = values[columns["goal_x"]];
+    c.goal_y = values[columns["goal_y"]];
+    for (int i = 0; i < kStageNum; ++i) {
+      std::map<std::string, int>::iterator it = columns.find(kStages[i]);
+      c.stage_times[i] = it == columns.end() ? 0.0 : values[it->second];
+    }
+    c.decision.state = static_cast<int>(values[columns["state"]]);
+    c.decision.recovery_trigger = static_cast<int>(values[columns["recovery_trigger"]]);
+    c.decision.planning_state = static_cast<int>(values[columns["planning_state"]]);
+    c.decision.done = values[columns["done"]] != 0.0;
+    record->cycles.push_back(c);
+  }
+
+  for (size_t i = 0; i < record->cycles.size(); ++i) {
+    const Cycle& c = record->cycles[i];
+    if (record->goals.empty() || record->goals.back().cycles.back().decision.done ||
+        hypot(c.goal_x - record->goals.back().goal_x, c.goal_y - record->goals.back().goal_y) > kSameGoalDistance) {
+      GoalRun run;
+      run.goal_x = c.goal_x;
+      run.goal_y = c.goal_y;
+      record->goals.push_back(run);
+    }
+    GoalRun& run = record->goals.back();
+    if (run.trace.empty() || run.trace.back() != c.decision) {
+      run.trace.push_back(c.decision);
+      run.trace_cycle.push_back(run.cycles.size());
+    }
+    run.cycles.push_back(c);
+  }
+  return true;
+}
+
+double Percentile(std::vector<double> values, double p) {
+  if (values.empty()) return 0.0;
+  size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+struct StageTiming {
+  double mean, p95, max;
+};
+
+StageTiming Timing(const Record& record, int stage) {
+  std::vector<double> values;
+  StageTiming timing = {0.0, 0.0, 0.0};
+  for (size_t i = 0; i < record.cycles.size(); ++i) {
+    double t = record.cycles[i].stage_times[stage];
+    values.push_back(t);
+    timing.mean += t;
+    timing.max = std::max(timing.max, t);
+  }
+  if (!values.empty()) timing.mean /= values.size();
+  timing.p95 = Percentile(values, 0.95);
+  return timing;
+}
+
+void PrintRecord(const Record& record) {
+  printf("%s: %zu cycles, %zu goals\n", record.file.c_str(), record.cycles.size(), record.goals.size());
+  for (size_t g = 0; g < record.goals.size(); ++g) {
+    const GoalRun& run = record.goals[g];
+    printf("  goal %zu (%.3f, %.3f): %zu cycles, %zu decisions\n", g, run.goal_x, run.goal_y,
+           run.cycles.size(), run.trace.size());
+    for (size_t i = 0; i < run.trace.size(); ++i) {
+      printf("    cycle %zu: %s\n", run.trace_cycle[i], DecisionString(run.trace[i]).c_str());
+    }
+  }
+  for (int i = 0; i < kStageNum; ++i) {
+    StageTiming timing = Timing(record, i);
+    printf("  %-18s mean %.6f p95 %.6f max %.6f\n", kStages[i], timing.mean, timing.p95, timing.max);
+  }
+}
+
+// returns the number of regressions found
+int Compare(const Record& baseline, const Record& candidate, double tolerance) {
+  int regressions = 0;
+  if (baseline.goals.size() != candidate.goals.size()) {
+    printf("REGRESSION: %zu goals in baseline, %zu in candidate\n", baseline.goals.size(), candidate.goals.size());
+    ++regressions;
+  }
+  size_t goal_num = std::min(baseline.goals.size(), candidate.goals.size());
+  for (size_t g = 0; g < goal_num; ++g) {
+    const GoalRun& b = baseline.goals[g];
+    const GoalRun& c = candidate.goals[g];
+    if (hypot(b.goal_x - c.goal_x, b.goal_y - c.goal_y) > kSameGoalDistance) {
+      printf("REGRESSION: goal %zu is (%.3f, %.3f) in baseline, (%.3f, %.3f) in candidate\n",
+             g, b.goal_x, b.goal_y, c.goal_x, c.goal_y);
+      ++regressions;
+      continue;
+    }
+    size_t i = 0;
+    while (i < b.trace.size() && i < c.trace.size() && b.trace[i] == c.trace[i]) ++i;
+    if (i == b.trace.size() && i == c.trace.size()) continue;
+    ++regressions;
+    if (i < c.trace.size()) {
+      const Cycle& at = c.cycles[c.trace_cycle[i]];
+      printf("REGRESSION: goal %zu decision %zu is %s in baseline, %s in candidate at stamp %.3f (%.3f, %.3f)\n",
+             g, i, i < b.trace.size() ? DecisionString(b.trace[i]).c_str() : "end of run",
+             DecisionString(c.trace[i]).c_str(), at.stamp, at.x, at.y);
+    } else {
+      printf("REGRESSION: goal %zu decision %zu is %s in baseline, candidate run ended\n",
+             g, i, DecisionString(b.trace[i]).c_str());
+    }
+  }
+
+  for (int i = 0; i < kStageNum; ++i) {
+    StageTiming b = Timing(baseline, i);
+    StageTiming c = Timing(candidate, i);
+    bool slower = c.p95 > b.p95 * (1.0 + tolerance) && c.p95 - b.p95 > kMinTimingRegression;
+    printf("%s%-18s p95 %.6f -> %.6f, mean %.6f -> %.6f\n", slower ? "REGRESSION: " : "",
+           kStages[i], b.p95, c.p95, b.mean, c.mean);
+    if (slower) ++regressions;
+  }
+  return regressions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 4) {
+    fprintf(stderr, "usage: %s baseline.csv [candidate.csv] [timing_tolerance]\n", argv[0]);
+    return 2;
+  }
+  Record baseline;
+  if (!ReadRecord(argv[1], &baseline)) return 2;
+  PrintRecord(baseline);
+  if (argc == 2) return 0;
+
+  Record candidate;
+  if (!ReadRecord(argv[2], &candidate)) return 2;
+  PrintRecord(candidate);
+  double tolerance = argc > 3 ? atof(argv[3]) : 0.2;
+  int regressions = Compare(baseline, candidate, tolerance);
+  printf("%d regressions\n", regressions);
+  return regressions == 0 ? 0 : 1;
+}
@@ -17,9 +17,11 @@
 
 namespace service_robot {
 
-FootprintChecker::FootprintChecker(const costmap_2d::Costmap2D* costmap) : costmap_(costmap) { }
+FootprintChecker::FootprintChecker(const costmap_2d::Costmap2D* costmap, const costmap_2d::Costmap2D* planner_costmap)
+    : costmap_(costmap), planner_costmap_(planner_costmap), using_static_costmap_(false) { }
 
 void FootprintChecker::setStaticCostmap(costmap_2d::Costmap2DROS* costmap_ros, bool use_static_costmap) {
+  using_static_costmap_ = use_static_costmap;
   if (!use_static_costmap) {
     costmap_ = costmap_ros->getCostmap();
     GAUSSIAN_INFO("[Footprint Check] take normal costmap!");
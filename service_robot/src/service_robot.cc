@@ -21,7 +21,7 @@
 namespace service_robot {
 
 ServiceRobot::ServiceRobot(tf::TransformListener* tf)
-    : tf_(*tf), controller_costmap_ros_(NULL),
+    : tf_(*tf), planner_costmap_ros_(NULL), controller_costmap_ros_(NULL),
       controllers_(NULL), options_(NULL),
       new_global_plan_(false) {
   ros::NodeHandle private_nh("~");
@@ -71,6 +71,7 @@ ServiceRobot::ServiceRobot(tf::TransformListener* tf)
   private_nh.param("p29", init_path_circle_center_extend_y_, 0.08);
   private_nh.param("p30", recovery_footprint_extend_x_, 0.03);
   private_nh.param("p31", recovery_footprint_extend_y_, 0.03);
+  private_nh.param("cycle_record_file", cycle_record_file_, std::string(""));
 
   if (!ReadConfigFromParams(private_nh, &front_protector_list_)) {
     GAUSSIAN_ERROR("[SERVICEROBOT] read front_protector_list failed");
@@ -107,10 +108,27 @@ ServiceRobot::ServiceRobot(tf::TransformListener* tf)
   goal_reached_pub_ = simple_nh.advertise<std_msgs::UInt32>("/GUI/IS_GOAL_REACHED", 1);
   std::cout << "subscribe init finish here" << std::endl;
   private_nh.param("shutdown_costmaps", shutdown_costmaps_, false);
+  private_nh.param("split_controller_costmap", split_controller_costmap_, false);
 
   // create the ros wrapper for the planner's costmap... and initializer a pointer we'll use with the underlying map
-  controller_costmap_ros_ = new costmap_2d::Costmap2DROS("global_costmap", tf_);
-  controller_costmap_ros_->pause();
+  planner_costmap_ros_ = new costmap_2d::Costmap2DROS("global_costmap", tf_);
+  planner_costmap_ros_->pause();
+
+  // create the ros wrapper for the controller's costmap, it should be a rolling
+  // window in the same global frame, since checks out of it fall back to
+  // planner's costmap
+  controller_costmap_ros_ = planner_costmap_ros_;
+  if (split_controller_costmap_) {
+    controller_costmap_ros_ = new costmap_2d::Costmap2DROS("local_costmap", tf_);
+    controller_costmap_ros_->pause();
+    if (controller_costmap_ros_->getGlobalFrameID() != planner_costmap_ros_->getGlobalFrameID()) {
+      GAUSSIAN_ERROR("[SERVICEROBOT] local_costmap frame %s differs from global_costmap frame %s, share global_costmap",
+                     controller_costmap_ros_->getGlobalFrameID().c_str(), planner_costmap_ros_->getGlobalFrameID().c_str());
+      delete controller_costmap_ros_;
+      controller_costmap_ros_ = planner_costmap_ros_;
+      split_controller_costmap_ = false;
+    }
+  }
 
   // initialize the global planner
   if (!LoadGlobalPlanner()) {
@@ -123,14 +141,18 @@ ServiceRobot::ServiceRobot(tf::TransformListener* tf)
   }
 
   // Start actively updating costmaps based on sensor data
-  controller_costmap_ros_->start();
-  controller_costmap_ros_->getCostmap();
+  planner_costmap_ros_->start();
+  planner_costmap_ros_->getCostmap();
+  if (split_controller_costmap_) {
+    controller_costmap_ros_->start();
+    controller_costmap_ros_->getCostmap();
+  }
 
   // if we shutdown our costmaps when we're deactivated... we'll do that now
   if (shutdown_costmaps_) {
     ROS_DEBUG_NAMED("move_base", "Stopping costmaps initially");
-    controller_costmap_ros_->stop();
-   // controller_costmap_ros_->stop();
+    planner_costmap_ros_->stop();
+    if (split_controller_costmap_) controller_costmap_ros_->stop();
   }
 
   // create fixpattern_path object
@@ -138,7 +160,7 @@ ServiceRobot::ServiceRobot(tf::TransformListener* tf)
   astar_path_ = new fixpattern_path::Path();
 
   // create controller option and intialize controllers
-  options_ = new AStarControlOption(&tf_, controller_costmap_ros_,
+  options_ = new AStarControlOption(&tf_, planner_costmap_ros_, controller_costmap_ros_,
                                               robot_base_frame_, global_frame_, planner_frequency_,
                                               controller_frequency_, inscribed_radius_, planner_patience_,
                                               controller_patience_, oscillation_timeout_,
@@ -176,12 +198,13 @@ ServiceRobot::ServiceRobot(tf::TransformListener* tf)
   reinterpret_cast<AStarControlOption*>(options_)->init_path_circle_center_extend_y = init_path_circle_center_extend_y_;
   reinterpret_cast<AStarControlOption*>(options_)->recovery_footprint_extend_x = recovery_footprint_extend_x_;
   reinterpret_cast<AStarControlOption*>(options_)->recovery_footprint_extend_y = recovery_footprint_extend_y_;
+  reinterpret_cast<AStarControlOption*>(options_)->cycle_record_file = cycle_record_file_;
   reinterpret_cast<AStarControlOption*>(options_)->fixpattern_footprint_padding = fixpattern_footprint_padding_;
 //  reinterpret_cast<AStarControlOption*>(options_)->global_planner_goal = &global_planner_goal_;
 //  reinterpret_cast<AStarControlOption*>(options_)->global_planner_goal_type = &global_planner_goal_type_;
   reinterpret_cast<AStarControlOption*>(options_)->movebase_goal = &movebase_goal_;
 
-  controllers_ = new AStarController(&tf_, controller_costmap_ros_);
+  controllers_ = new AStarController(&tf_, planner_costmap_ros_, controller_costmap_ros_);
 
   // initialize environment_
   environment_.run_flag = false;
@@ -251,9 +274,12 @@ void ServiceRobot::TerminateCB(const std_msgs::UInt32::ConstPtr& param) {
 ServiceRobot::~ServiceRobot() {
   delete control_thread_;
 
-  if (controller_costmap_ros_ != NULL)
+  if (controller_costmap_ros_ != NULL && controller_costmap_ros_ != planner_costmap_ros_)
     delete controller_costmap_ros_;
 
+  if (planner_costmap_ros_ != NULL)
+    delete planner_costmap_ros_;
+
   delete controllers_;
 //  delete options_ ;
 
@@ -315,10 +341,10 @@ void ServiceRobot::ControlThread() {
 bool ServiceRobot::LoadGlobalPlanner() {
   // check if a non fully qualified name has potentially been passed in
   astar_global_planner_ = boost::shared_ptr<nav_core::BaseGlobalPlanner>(new global_planner::GlobalPlanner());
-  astar_global_planner_->initialize("PA", controller_costmap_ros_);
+  astar_global_planner_->initialize("PA", planner_costmap_ros_);
   sbpl_global_planner_ = boost::shared_ptr<search_based_global_planner::SearchBasedGlobalPlanner>(
       new search_based_global_planner::SearchBasedGlobalPlanner());
-  sbpl_global_planner_->initialize("PS", controller_costmap_ros_);
+  sbpl_global_planner_->initialize("PS", planner_costmap_ros_);
   return true;
 }
 